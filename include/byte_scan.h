@@ -0,0 +1,221 @@
+//
+// Created by coder on 16-10-13.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief   Find bytes in a buffer by 16 or 32 bytes a time with SSE2 or AVX2,
+ *          or byte by byte if neither is enabled. The sets of bytes are
+ *          small, at most kMaxSetSize bytes, and could include all the bytes
+ *          with the high bit set, such as the ones of UTF-8.
+ */
+namespace byte_scan {
+
+constexpr size_t kMaxSetSize{8};
+
+namespace detail {
+
+inline int CountTrailingZero(uint32_t mask) {
+  return __builtin_ctz(mask);
+}
+
+inline int CountLeadingZero(uint32_t mask) {
+  return __builtin_clz(mask);
+}
+
+inline int PopCount(uint32_t mask) {
+  return __builtin_popcount(mask);
+}
+
+#if defined(__AVX2__)
+
+struct Simd {
+  typedef __m256i Vector;
+  constexpr static size_t kWidth{32};
+  constexpr static uint32_t kFullMask{0xFFFFFFFFu};
+
+  static Vector Load(const char *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+
+  static Vector Splat(char c) {
+    return _mm256_set1_epi8(c);
+  }
+
+  static Vector Equal(Vector a, Vector b) {
+    return _mm256_cmpeq_epi8(a, b);
+  }
+
+  static Vector Or(Vector a, Vector b) {
+    return _mm256_or_si256(a, b);
+  }
+
+  static uint32_t Mask(Vector v) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+  }
+};
+
+#elif defined(__SSE2__)
+
+struct Simd {
+  typedef __m128i Vector;
+  constexpr static size_t kWidth{16};
+  constexpr static uint32_t kFullMask{0xFFFFu};
+
+  static Vector Load(const char *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  }
+
+  static Vector Splat(char c) {
+    return _mm_set1_epi8(c);
+  }
+
+  static Vector Equal(Vector a, Vector b) {
+    return _mm_cmpeq_epi8(a, b);
+  }
+
+  static Vector Or(Vector a, Vector b) {
+    return _mm_or_si128(a, b);
+  }
+
+  static uint32_t Mask(Vector v) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(v));
+  }
+};
+
+#endif
+
+inline bool InSet(char c, const char *set, size_t n, bool has_high = false) {
+  if (has_high && (c & 0x80)) {
+    return true;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (set[i] == c) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+/**
+ * @return    the mask of bytes at p which are in the set
+ */
+inline uint32_t SetMask(const char *p, const Simd::Vector *set, size_t n,
+                        bool has_high = false) {
+  Simd::Vector chunk = Simd::Load(p);
+  Simd::Vector result = has_high ? chunk : Simd::Equal(chunk, set[0]);
+  for (size_t i = has_high ? 0 : 1; i < n; ++i) {
+    result = Simd::Or(result, Simd::Equal(chunk, set[i]));
+  }
+  // only the high bits are collected
+  return Simd::Mask(result);
+}
+
+/**
+ * @param is_in   find the first byte in the set, or the first one not in
+ */
+inline const char *Find(const char *p, const char *end,
+                        const char *set, size_t n, bool has_high, bool is_in) {
+  Simd::Vector splats[kMaxSetSize];
+  for (size_t i = 0; i < n; ++i) {
+    splats[i] = Simd::Splat(set[i]);
+  }
+
+  uint32_t flip = is_in ? 0 : Simd::kFullMask;
+  while (static_cast<size_t>(end - p) >= Simd::kWidth) {
+    uint32_t mask = SetMask(p, splats, n, has_high) ^ flip;
+    if (mask) {
+      return p + CountTrailingZero(mask);
+    }
+    p += Simd::kWidth;
+  }
+
+  while (p < end && InSet(*p, set, n, has_high) != is_in) {
+    p += 1;
+  }
+  return p;
+}
+
+#else
+
+inline const char *Find(const char *p, const char *end,
+                        const char *set, size_t n, bool has_high, bool is_in) {
+  while (p < end && InSet(*p, set, n, has_high) != is_in) {
+    p += 1;
+  }
+  return p;
+}
+
+#endif
+
+} // end of namespace detail
+
+/**
+ * @param has_high    the bytes with the high bit set are in the set too
+ * @return            the first position in [p, end) whose byte is in the
+ *                    set, or end
+ */
+inline const char *FindAny(const char *p, const char *end,
+                           const char *set, size_t n, bool has_high = false) {
+  if (0 == n && !has_high) {
+    return end;
+  }
+  return detail::Find(p, end, set, n, has_high, true);
+}
+
+/**
+ * @return    the first position in [p, end) whose byte is not in the set,
+ *            or end
+ */
+inline const char *SkipAny(const char *p, const char *end,
+                           const char *set, size_t n, bool has_high = false) {
+  if (0 == n && !has_high) {
+    return p;
+  }
+  return detail::Find(p, end, set, n, has_high, false);
+}
+
+inline const char *FindByte(const char *p, const char *end, char c) {
+  return FindAny(p, end, &c, 1);
+}
+
+/**
+ * @param last    set to the position of the last c found, unchanged if none
+ * @return        the number of c in [p, end)
+ */
+inline size_t CountByte(const char *p, const char *end, char c,
+                        const char *&last) {
+  size_t count = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  detail::Simd::Vector splat = detail::Simd::Splat(c);
+  while (static_cast<size_t>(end - p) >= detail::Simd::kWidth) {
+    uint32_t mask = detail::SetMask(p, &splat, 1);
+    if (mask) {
+      count += detail::PopCount(mask);
+      last = p + 31 - detail::CountLeadingZero(mask);
+    }
+    p += detail::Simd::kWidth;
+  }
+#endif
+
+  for (; p < end; ++p) {
+    if (c == *p) {
+      count += 1;
+      last = p;
+    }
+  }
+  return count;
+}
+
+} // end of namespace byte_scan
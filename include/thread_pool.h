@@ -0,0 +1,186 @@
+//
+// Created by coder on 16-10-12.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief   A thread pool, each worker owns a deque of tasks. A worker takes
+ *          tasks from the back of its own deque, and steals from the front
+ *          of the others' when its own is empty.
+ */
+class WorkStealingPool {
+ public:
+  typedef std::function<void()> Task;
+
+  constexpr static size_t kNotWorker{SIZE_MAX};
+
+  /**
+   * @param thread_num  0 for the hardware concurrency
+   */
+  explicit WorkStealingPool(size_t thread_num = 0) {
+    if (0 == thread_num) {
+      thread_num = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < thread_num; ++i) {
+      queues_.emplace_back(new TaskQueue);
+    }
+    for (size_t i = 0; i < thread_num; ++i) {
+      threads_.emplace_back(&WorkStealingPool::Run, this, i);
+    }
+  }
+
+  ~WorkStealingPool() {
+    Wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopping_ = true;
+    }
+    wake_cv_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  size_t size() const {
+    return threads_.size();
+  }
+
+  /**
+   * @return    the index of worker running the current thread, or kNotWorker
+   */
+  static size_t CurrentWorker() {
+    return CurrentState().index;
+  }
+
+  /**
+   * @brief     the task submitted by a worker of this pool is pushed into its
+   *            own deque, otherwise the deques are chosen in turn
+   */
+  void Submit(Task task) {
+    const WorkerState &state = CurrentState();
+    size_t index = this == state.pool ? state.index
+                                      : next_queue_++ % queues_.size();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queued_num_ += 1;
+      pending_num_ += 1;
+    }
+    {
+      std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+      queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_cv_.notify_one();
+  }
+
+  /**
+   * @brief     block until all the submitted tasks are finished
+   */
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return 0 == pending_num_; });
+  }
+
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  /**
+   * @brief     the worker running the current thread, a task may submit into
+   *            another pool, whose deques are not indexed by it
+   */
+  struct WorkerState {
+    const WorkStealingPool *pool;
+    size_t index;
+  };
+
+  static WorkerState &CurrentState() {
+    static thread_local WorkerState state{nullptr, kNotWorker};
+    return state;
+  }
+
+  bool PopTask(size_t index, Task &task) {
+    TaskQueue &queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+  }
+
+  bool StealTask(size_t index, Task &task) {
+    for (size_t i = 1; i < queues_.size(); ++i) {
+      TaskQueue &queue = *queues_[(index + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Run(size_t index) {
+    CurrentState() = {this, index};
+
+    while (true) {
+      Task task;
+      if (PopTask(index, task) || StealTask(index, task)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          queued_num_ -= 1;
+        }
+        task();
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          pending_num_ -= 1;
+          if (0 == pending_num_) {
+            done_cv_.notify_all();
+          }
+        }
+        continue;
+      }
+
+      // the queued tasks may be not pushed yet, so try again if any
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_cv_.wait(lock, [this] { return is_stopping_ || queued_num_ > 0; });
+      if (is_stopping_ && 0 == queued_num_) {
+        return;
+      }
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<TaskQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable done_cv_;
+  size_t queued_num_{0};
+  size_t pending_num_{0};
+  bool is_stopping_{false};
+};
@@ -16,9 +16,12 @@ class AstNode {
  public:
   AstNode(Symbol symbol) : symbol_(symbol) {}
 
-  AstNode(Token &&token)
+  /**
+   * @brief     the node refers to the text of token, which should outlive it
+   */
+  AstNode(const TokenView &token)
       : symbol_(token.symbol),
-        str_(std::move(token.text)),
+        str_(token.text),
         row_(token.row),
         column_(token.column) {}
 
@@ -26,7 +29,7 @@ class AstNode {
     return symbol_;
   }
 
-  const std::string &str() const {
+  const TextSlice &str() const {
     return str_;
   }
 
@@ -38,8 +41,8 @@ class AstNode {
     return column_;
   }
 
-  void FetchToken(Token &&token) {
-    str_ = std::move(token.text);
+  void FetchToken(const TokenView &token) {
+    str_ = token.text;
     row_ = token.row;
     column_ = token.column;
   }
@@ -59,7 +62,7 @@ class AstNode {
  private:
   std::deque<AstNode *> children_;
   Symbol symbol_;
-  std::string str_;
+  TextSlice str_;
   size_t row_{0};
   size_t column_{0};
 };
@@ -73,8 +76,8 @@ class Ast {
     return node_manager_.Create(symbol);
   }
 
-  AstNode *CreateNode(Token &&token) {
-    return node_manager_.Create(std::move(token));
+  AstNode *CreateNode(const TokenView &token) {
+    return node_manager_.Create(token);
   }
 
   void set_root(AstNode *node) {
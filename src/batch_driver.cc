@@ -0,0 +1,162 @@
+//
+// Created by coder on 16-10-12.
+//
+
+#include "batch_driver.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "simplelogger.h"
+#include "thread_pool.h"
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+
+extern simple_logger::BaseLogger logger;
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool EndsWith(const string &s, const string &suffix) {
+  return s.size() >= suffix.size() &&
+      0 == s.compare(s.size() - suffix.size(), suffix.size(), suffix);
+}
+
+static bool CollectRecur(const string &path,
+                         const string &suffix,
+                         bool is_explicit,
+                         vector<string> &files) {
+  struct stat path_stat;
+  if (0 != stat(path.c_str(), &path_stat)) {
+    logger.error("could not access {}", path);
+    return false;
+  }
+
+  if (!S_ISDIR(path_stat.st_mode)) {
+    // the files given explicitly are always compiled
+    if (is_explicit || EndsWith(path, suffix)) {
+      files.push_back(path);
+    }
+    return true;
+  }
+
+  DIR *dir = opendir(path.c_str());
+  if (!dir) {
+    logger.error("could not open directory {}", path);
+    return false;
+  }
+
+  vector<string> children;
+  while (dirent *entry = readdir(dir)) {
+    string name(entry->d_name);
+    if ("." != name && ".." != name) {
+      children.push_back(EndsWith(path, "/") ? path + name : path + "/" + name);
+    }
+  }
+  closedir(dir);
+
+  std::sort(children.begin(), children.end());
+
+  bool result = true;
+  for (auto &child : children) {
+    result = CollectRecur(child, suffix, false, files) && result;
+  }
+  return result;
+}
+
+bool CollectSourceFiles(const vector<string> &paths,
+                        const string &suffix,
+                        vector<string> &files) {
+  bool result = true;
+  for (auto &path : paths) {
+    result = CollectRecur(path, suffix, true, files) && result;
+  }
+  return result;
+}
+
+static bool ReadFile(const string &path, string &data) {
+  std::ifstream fin(path, std::ios::binary);
+  if (!fin) {
+    return false;
+  }
+
+  std::ostringstream oss;
+  oss << fin.rdbuf();
+  data = oss.str();
+  return !fin.bad();
+}
+
+void BatchDriver::CompileFile(LLParser &ll_parser,
+                              FileResult &result) {
+  string data;
+  if (!ReadFile(result.path, data)) {
+    logger.error("could not read {}", result.path);
+    return;
+  }
+  result.is_read = true;
+  result.bytes = data.size();
+
+  auto start = Clock::now();
+
+  // the tokens are lexed on demand by parser, without a token vector
+  TokenizerCursor cursor(tokenizer_, data.data(), data.data() + data.size());
+  auto grammar_data = create_grammar_data_();
+  result.is_parsed = ll_parser.Parse(grammar_data.get(), cursor);
+  // the text after a syntax error is never lexed
+  result.is_lexed = !cursor.IsError()
+      && cursor.CurrentPos() == data.data() + data.size();
+  result.token_num = cursor.token_num();
+
+  result.seconds = SecondsSince(start);
+
+  if (!result.IsSucceed()) {
+    logger.error("failed to compile {}", result.path);
+  }
+}
+
+BatchReport BatchDriver::Run(const vector<string> &files, size_t thread_num) {
+  BatchReport report;
+  report.files.resize(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    report.files[i].path = files[i];
+  }
+
+  auto start = Clock::now();
+  {
+    WorkStealingPool pool(thread_num);
+    report.thread_num = pool.size();
+
+    vector<LLParser> ll_parsers(pool.size(), LLParser(grammar_, ll_table_));
+
+    for (auto &result : report.files) {
+      FileResult *p = &result;
+      pool.Submit([this, p, &ll_parsers] {
+        size_t worker = WorkStealingPool::CurrentWorker();
+        p->worker = worker;
+        CompileFile(ll_parsers[worker], *p);
+      });
+    }
+    pool.Wait();
+  }
+  report.seconds = SecondsSince(start);
+
+  for (auto &result : report.files) {
+    report.total_bytes += result.bytes;
+    report.total_tokens += result.token_num;
+    if (!result.IsSucceed()) {
+      report.failed_num += 1;
+    }
+  }
+
+  return report;
+}
@@ -0,0 +1,126 @@
+//
+// Created by coder on 16-10-12.
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grammar.h"
+#include "ll_parser.h"
+#include "tokenizer.h"
+
+/**
+ * @brief   the result of compiling one source file
+ */
+struct FileResult {
+  std::string path;
+  size_t bytes{0};
+  /**
+   * @brief     the tokens pulled by parser, which stops at the first error
+   */
+  size_t token_num{0};
+  bool is_read{false};
+
+  /**
+   * @brief     whether the whole file is lexed without error, false if the
+   *            parser stops before the end
+   */
+  bool is_lexed{false};
+  bool is_parsed{false};
+
+  /**
+   * @brief     the seconds spent on lexing and parsing the file
+   */
+  double seconds{0.0};
+
+  /**
+   * @brief     the index of worker which compiled the file
+   */
+  size_t worker{0};
+
+  bool IsSucceed() const {
+    return is_read && is_lexed && is_parsed;
+  }
+};
+
+/**
+ * @brief   the results of a batch, in the same order with the input files
+ */
+struct BatchReport {
+  std::vector<FileResult> files;
+  size_t thread_num{0};
+  size_t total_bytes{0};
+  size_t total_tokens{0};
+  size_t failed_num{0};
+
+  /**
+   * @brief     the wall-clock seconds of the whole batch
+   */
+  double seconds{0.0};
+
+  double BytesPerSecond() const {
+    return seconds > 0.0 ? total_bytes / seconds : 0.0;
+  }
+
+  double TokensPerSecond() const {
+    return seconds > 0.0 ? total_tokens / seconds : 0.0;
+  }
+};
+
+/**
+ * @brief   create a fresh grammar data for parsing one file
+ */
+typedef std::function<std::shared_ptr<void>()> GrammarDataFactory;
+
+/**
+ * @brief         the directories are searched recursively for the files
+ *                ending with the suffix, which are sorted by path
+ * @param paths   files or directories
+ * @param suffix  such as ".go"
+ * @param files   the files collected
+ * @return        false if some path could not be accessed
+ */
+bool CollectSourceFiles(const std::vector<std::string> &paths,
+                        const std::string &suffix,
+                        std::vector<std::string> &files);
+
+/**
+ * @brief   Lex and parse many files on a work-stealing thread pool.
+ *
+ * @details The tokenizer, grammar and LL(1) table are shared by all the
+ *          workers and never modified. Each worker has its own LLParser, and
+ *          each file gets a grammar data from the factory.
+ */
+class BatchDriver {
+ public:
+  /**
+   * @brief     the arguments should outlive the driver
+   */
+  BatchDriver(const Tokenizer &tokenizer,
+              const Grammar &grammar,
+              const LLTable &ll_table,
+              GrammarDataFactory create_grammar_data)
+      : tokenizer_(tokenizer), grammar_(grammar), ll_table_(ll_table),
+        create_grammar_data_(std::move(create_grammar_data)) {}
+
+  /**
+   * @param files       the source files
+   * @param thread_num  the number of workers, 0 for hardware concurrency
+   * @return            the per-file results and the aggregate throughput
+   */
+  BatchReport Run(const std::vector<std::string> &files,
+                  size_t thread_num = 0);
+
+ private:
+  void CompileFile(LLParser &ll_parser, FileResult &result);
+
+ private:
+  const Tokenizer &tokenizer_;
+  const Grammar &grammar_;
+  const LLTable &ll_table_;
+  GrammarDataFactory create_grammar_data_;
+};
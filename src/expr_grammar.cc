@@ -74,10 +74,10 @@ std::shared_ptr<ExprGrammarData> CreateGrammarData() {
   return std::make_shared<ExprGrammarData>();
 }
 
-void TokenFeeder(void *grammar_data, Token &&token) {
+void TokenFeeder(void *grammar_data, const TokenView &token) {
   ExprGrammarData *expr_data = static_cast<ExprGrammarData *>(grammar_data);
 
-  auto ast_node = expr_data->ast()->CreateNode(move(token));
+  auto ast_node = expr_data->ast()->CreateNode(token);
   expr_data->node_record().push_back(ast_node);
 
   logger.debug("{}() node record size {} feed {}",
@@ -211,4 +211,32 @@ Grammar BuildExprGrammar() {
   return builder.Build();
 }
 
+std::vector<BinaryOperator> ExprBinaryOperators() {
+  return {{kAdd, 1, false}, {kSub, 1, false},
+          {kMul, 2, false}, {kDiv, 2, false}};
+}
+
+OperatorHooks CreateExprOperatorHooks() {
+  OperatorHooks hooks;
+
+  hooks.mark = [](void *grammar_data) {
+    auto expr_data = static_cast<ExprGrammarData *>(grammar_data);
+    return expr_data->node_record().size();
+  };
+
+  // a factor is reduced to one node by its snippets
+  hooks.reduce = [](void *grammar_data, size_t lhs_mark, size_t op_mark) {
+    auto expr_data = static_cast<ExprGrammarData *>(grammar_data);
+    auto &node_record = expr_data->node_record();
+
+    auto op_node = node_record[op_mark];
+    op_node->push_child_back(node_record[lhs_mark]);
+    op_node->push_child_back(node_record.back());
+    node_record.resize(lhs_mark);
+    node_record.push_back(op_node);
+  };
+
+  return hooks;
+}
+
 } // end of namespace expr_grammar
@@ -7,6 +7,7 @@
 #include <stack>
 
 #include "grammar.h"
+#include "ll_parser.h"
 #include "tokenizer.h"
 
 namespace expr_grammar {
@@ -50,4 +51,15 @@ class ExprGrammarData {
 
 std::shared_ptr<ExprGrammarData> CreateGrammarData();
 
+/**
+ * @brief   the binary operators of kExpr, whose operand is kFactor
+ */
+std::vector<BinaryOperator> ExprBinaryOperators();
+
+/**
+ * @brief   the hooks of precedence climbing, an operator node takes its two
+ *          operands as children
+ */
+OperatorHooks CreateExprOperatorHooks();
+
 } // end of namespace expr_grammar
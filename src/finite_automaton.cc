@@ -53,7 +53,7 @@ class DFAConverter {
 
   NFAEdge::CharMasks GetEdgeCharMasks(const NumberSet &num_set);
 
-  NumberSet GetAdjacentSet(const NumberSet &curr_set, char c);
+  NumberSet GetAdjacentSet(const NumberSet &curr_set, int char_class);
 
   DFANode *ConstructDFADiagram();
 
@@ -70,8 +70,8 @@ class DFAConverter {
 };
 
 void DFAConverter::ConversionPreamble() {
-  e_closures_.resize(nfa_->size());
-  // set_to_dfa_node_.reserve(nfa_->size());
+  e_closures_.assign(nfa_->size(), NumberSet(nfa_->size()));
+  set_to_dfa_node_.reserve(nfa_->size());
 }
 
 const NumberSet &DFAConverter::EpsilonClosure(const NFANode *u) {
@@ -87,8 +87,7 @@ const NumberSet &DFAConverter::EpsilonClosure(const NFANode *u) {
       NFANode *v = edge->next_node();
 
       if (!s.contains(v->number())) {
-        auto v_s = EpsilonClosure(v);
-        s.insert(v_s);
+        s.insert(EpsilonClosure(v));
       }
     }
   }
@@ -105,13 +104,16 @@ NFAEdge::CharMasks DFAConverter::GetEdgeCharMasks(const NumberSet &num_set) {
   return char_masks;
 }
 
-NumberSet DFAConverter::GetAdjacentSet(const NumberSet &curr_set, char c) {
-  NumberSet adjacent_set;
+NumberSet DFAConverter::GetAdjacentSet(const NumberSet &curr_set,
+                                       int char_class) {
+  // all the bytes in the same class share the same edges
+  char c = nfa_->char_classes().GetRepresentative(char_class);
+
+  NumberSet adjacent_set(nfa_->size());
   for (int num : curr_set) {
     for (NFAEdge *edge : GetNFANode(num)->edges()) {
       if (edge->test(c)) {
-        auto e_closure = EpsilonClosure(edge->next_node());
-        adjacent_set.insert(e_closure);
+        adjacent_set.insert(EpsilonClosure(edge->next_node()));
       }
     }
   }
@@ -128,7 +130,7 @@ DFANode *DFAConverter::ConstructDFADiagram() {
   q.push(start_set);
 
   while (!q.empty()) {
-    NumberSet curr_set = q.front();
+    const NumberSet &curr_set = q.front();
     DFANode *dfa_curr = set_to_dfa_node_[curr_set];
 
     /*
@@ -136,10 +138,12 @@ DFANode *DFAConverter::ConstructDFADiagram() {
      */
 
     NFAEdge::CharMasks chars = GetEdgeCharMasks(curr_set);
-    for (char c = 0; c < CHAR_MAX; ++c) {
-      if (chars.test(c)) {
+    const CharClasses &char_classes = nfa_->char_classes();
+    for (size_t k = 0; k < char_classes.size(); ++k) {
+      auto c = static_cast<unsigned char>(char_classes.GetRepresentative(k));
+      if (c < chars.size() && chars.test(c)) {
 
-        NumberSet adjacent_set = GetAdjacentSet(curr_set, c);
+        NumberSet adjacent_set = GetAdjacentSet(curr_set, k);
 
         auto iter = set_to_dfa_node_.find(adjacent_set);
         if (set_to_dfa_node_.end() == iter) {
@@ -150,11 +154,11 @@ DFANode *DFAConverter::ConstructDFADiagram() {
         DFANode *dfa_adjacent = iter->second;
 
         /*
-        logger.debug("char {}: adjacent set {}, node: {}", c,
+        logger.debug("class {}: adjacent set {}, node: {}", k,
                      to_string(adjacent_set), dfa_adjacent);
                      */
 
-        dfa_curr->AddEdge(c, dfa_adjacent);
+        dfa_curr->AddEdge(k, dfa_adjacent);
       }
     }
 
@@ -167,8 +171,8 @@ DFANode *DFAConverter::ConstructDFADiagram() {
 vector<DFANode *> DFAConverter::CollectEndNodes() {
   // collect END nodes
   vector<DFANode *> ends;
-  for (auto p : set_to_dfa_node_) {
-    NumberSet num_set = p.first;
+  for (auto &p : set_to_dfa_node_) {
+    const NumberSet &num_set = p.first;
     DFANode *dfa_node = p.second;
 
     for (int num : num_set) {
@@ -195,7 +199,7 @@ vector<DFANode *> DFAConverter::CollectEndNodes() {
 vector<DFANode *> DFAConverter::CollectAllNodes() {
   // collect all nodes and number them
   vector<DFANode *> nodes;
-  for (auto p : set_to_dfa_node_) {
+  for (auto &p : set_to_dfa_node_) {
     nodes.push_back(p.second);
   }
   return nodes;
@@ -210,7 +214,8 @@ shared_ptr<DFA> DFAConverter::Convert() {
   auto ends = CollectEndNodes();
   auto nodes = CollectAllNodes();
 
-  return make_shared<DFA>(start, std::move(ends), std::move(nodes));
+  return make_shared<DFA>(start, std::move(ends), std::move(nodes),
+                         nfa_->char_classes());
 }
 
 
@@ -222,10 +227,11 @@ shared_ptr<DFA> DFAConverter::Convert() {
 class DFAOptimizer {
  private:
   friend shared_ptr<DFA>
-  regular_expression::MinimizeDFA(const shared_ptr<DFA> normal);
+  regular_expression::MinimizeDFA(const shared_ptr<DFA> normal,
+                                  MinimizeMethod method);
 
-  DFAOptimizer(const shared_ptr<DFA> normal) : normal_(normal),
-                                               num_to_set_(normal->size()) {}
+  DFAOptimizer(const shared_ptr<DFA> normal, MinimizeMethod method)
+      : normal_(normal), method_(method), num_to_set_(normal->size()) {}
 
   const DFANode *GetNormalNode(int number) {
     return normal_->GetNode(number);
@@ -235,19 +241,22 @@ class DFAOptimizer {
 
   void BuildPartitionMap();
 
-  std::unordered_set<char> GetSetEdgeChars(const NumberSet &s);
+  std::unordered_set<int> GetSetEdgeClasses(const NumberSet &s);
 
-  bool PartSetByChar(std::list<NumberSet> &parted_curr_set,
-                     const NumberSet &curr_set, char c);
+  bool PartSetByClass(std::list<NumberSet> &parted_curr_set,
+                      const NumberSet &curr_set, int char_class);
 
   void TryPartEachSet();
 
+  void RefineByHopcroft();
+
   shared_ptr<DFA> ConstructFromSets();
 
   shared_ptr<DFA> Minimize();
 
  private:
   const shared_ptr<DFA> normal_{nullptr};
+  MinimizeMethod method_;
   std::list<NumberSet> partition_;
   std::vector<NumberSet *> num_to_set_;
 };
@@ -259,14 +268,15 @@ void DFAOptimizer::InitPartition() {
   auto create_insert = [&](int priority, int number) {
     auto iter = part_map.find(priority);
     if (part_map.end() == iter) {
-      iter = part_map.emplace(priority, NumberSet()).first;
+      iter = part_map.emplace(priority, NumberSet(normal_->size())).first;
     }
     iter->second.insert(number);
   };
 
   for (size_t i = 0; i < normal_->size(); ++i) {
     auto *node = normal_->GetNode(i);
-    create_insert(node->priority(), node->number());
+    // END nodes without priority must not be mixed with normal nodes
+    create_insert(node->IsEnd() ? node->priority() : INT_MIN, node->number());
   }
 
   for (auto &p : part_map) {
@@ -282,24 +292,27 @@ void DFAOptimizer::BuildPartitionMap() {
   }
 }
 
-unordered_set<char> DFAOptimizer::GetSetEdgeChars(const NumberSet &s) {
-  unordered_set<char> chars;
+unordered_set<int> DFAOptimizer::GetSetEdgeClasses(const NumberSet &s) {
+  unordered_set<int> char_classes;
   for (int num : s) {
-    for (auto p : GetNormalNode(num)->edges()) {
-      chars.insert(p.first);
+    auto &edges = GetNormalNode(num)->edges();
+    for (size_t k = 0; k < edges.size(); ++k) {
+      if (edges[k]) {
+        char_classes.insert(k);
+      }
     }
   }
-  return chars;
+  return char_classes;
 }
 
-bool DFAOptimizer::PartSetByChar(list<NumberSet> &parted_sets,
-                                 const NumberSet &curr_set, char c) {
-  // logger.debug("part set: {} by {}", to_string(curr_set), c);
+bool DFAOptimizer::PartSetByClass(list<NumberSet> &parted_sets,
+                                  const NumberSet &curr_set, int char_class) {
+  // logger.debug("part set: {} by {}", to_string(curr_set), char_class);
 
   unordered_map<NumberSet *, NumberSet> old_to_new;
   for (int u_num : curr_set) {
     const DFANode *u = GetNormalNode(u_num);
-    const DFANode *v = u->GetNextNode(c);
+    const DFANode *v = u->GetNextNode(char_class);
 
     if (v) {
       old_to_new[num_to_set_[v->number()]].insert(u_num);
@@ -312,7 +325,7 @@ bool DFAOptimizer::PartSetByChar(list<NumberSet> &parted_sets,
   for (auto p : old_to_new) {
     if (p.second != curr_set) {
       is_parted = true;
-      PartSetByChar(parted_sets, p.second, c);
+      PartSetByClass(parted_sets, p.second, char_class);
     }
   }
 
@@ -341,12 +354,12 @@ void DFAOptimizer::TryPartEachSet() {
 
       // logger.debug("current set: {}", to_string(curr_set));
 
-      auto chars = GetSetEdgeChars(curr_set);
+      auto char_classes = GetSetEdgeClasses(curr_set);
       bool is_parted = false;
 
-      for (char c : chars) {
+      for (int k : char_classes) {
         list<NumberSet> parted_sets;
-        is_parted = PartSetByChar(parted_sets, curr_set, c);
+        is_parted = PartSetByClass(parted_sets, curr_set, k);
 
         if (is_parted) {
           new_partition.splice(new_partition.begin(), parted_sets);
@@ -370,6 +383,180 @@ void DFAOptimizer::TryPartEachSet() {
    */
 }
 
+void DFAOptimizer::RefineByHopcroft() {
+  const int node_num = normal_->size();
+  const int class_num = normal_->char_classes().size();
+
+  // a virtual dead state, all the missing edges go to it
+  const int dead = node_num;
+  const int state_num = node_num + 1;
+
+  auto get_next = [&](int u, int k) -> int {
+    if (dead == u) {
+      return dead;
+    }
+    const DFANode *v = GetNormalNode(u)->GetNextNode(k);
+    return v ? v->number() : dead;
+  };
+
+  // inverse transitions, the predecessors of v by class k are stored in
+  // inverse[inverse_begin[k * state_num + v], inverse_begin[... + 1])
+  vector<int> inverse_begin(class_num * state_num + 1, 0);
+  vector<int> inverse(class_num * state_num);
+  for (int u = 0; u < state_num; ++u) {
+    for (int k = 0; k < class_num; ++k) {
+      inverse_begin[k * state_num + get_next(u, k) + 1] += 1;
+    }
+  }
+  for (size_t i = 1; i < inverse_begin.size(); ++i) {
+    inverse_begin[i] += inverse_begin[i - 1];
+  }
+  {
+    vector<int> fill_pos(inverse_begin.begin(), inverse_begin.end() - 1);
+    for (int u = 0; u < state_num; ++u) {
+      for (int k = 0; k < class_num; ++k) {
+        inverse[fill_pos[k * state_num + get_next(u, k)]++] = u;
+      }
+    }
+  }
+
+  // the blocks are continuous ranges of elems, the marked states of a block
+  // are moved to the front of its range
+  struct Block {
+    int begin;
+    int end;
+    int marked;
+  };
+  vector<Block> blocks;
+  vector<int> elems;
+  vector<int> location(state_num);
+  vector<int> block_of(state_num);
+
+  auto push_state = [&](int u) {
+    location[u] = elems.size();
+    block_of[u] = blocks.size() - 1;
+    elems.push_back(u);
+    blocks.back().end += 1;
+  };
+
+  // the initial partition, the dead state joins the block of normal nodes
+  bool is_dead_pushed = false;
+  for (NumberSet &s : partition_) {
+    blocks.push_back({static_cast<int>(elems.size()),
+                      static_cast<int>(elems.size()), 0});
+    for (int num : s) {
+      push_state(num);
+    }
+    if (!is_dead_pushed && !GetNormalNode(*s.begin())->IsEnd()) {
+      push_state(dead);
+      is_dead_pushed = true;
+    }
+  }
+  if (!is_dead_pushed) {
+    blocks.push_back({static_cast<int>(elems.size()),
+                      static_cast<int>(elems.size()), 0});
+    push_state(dead);
+  }
+
+  auto block_size = [&](int b) {
+    return blocks[b].end - blocks[b].begin;
+  };
+
+  // every block except the largest one is used as splitter at first
+  vector<int> worklist;
+  vector<uint8_t> in_worklist(blocks.size(), 1);
+  int largest = 0;
+  for (int b = 1; b < static_cast<int>(blocks.size()); ++b) {
+    if (block_size(largest) < block_size(b)) {
+      largest = b;
+    }
+  }
+  for (int b = 0; b < static_cast<int>(blocks.size()); ++b) {
+    if (b != largest) {
+      worklist.push_back(b);
+    }
+  }
+  in_worklist[largest] = 0;
+
+  vector<int> splitter;
+  vector<int> touched;
+  while (!worklist.empty()) {
+    int splitter_block = worklist.back();
+    worklist.pop_back();
+    in_worklist[splitter_block] = 0;
+
+    splitter.assign(elems.begin() + blocks[splitter_block].begin,
+                    elems.begin() + blocks[splitter_block].end);
+
+    for (int k = 0; k < class_num; ++k) {
+      // mark all the predecessors of the splitter by class k
+      touched.clear();
+      for (int v : splitter) {
+        int index = k * state_num + v;
+        for (int i = inverse_begin[index]; i < inverse_begin[index + 1]; ++i) {
+          int u = inverse[i];
+          Block &block = blocks[block_of[u]];
+          int marked_pos = block.begin + block.marked;
+          if (location[u] < marked_pos) {
+            continue;
+          }
+
+          int swapped = elems[marked_pos];
+          std::swap(elems[location[u]], elems[marked_pos]);
+          location[swapped] = location[u];
+          location[u] = marked_pos;
+
+          if (0 == block.marked++) {
+            touched.push_back(block_of[u]);
+          }
+        }
+      }
+
+      // split the touched blocks into the marked part and the rest
+      for (int b : touched) {
+        if (blocks[b].marked == block_size(b)) {
+          blocks[b].marked = 0;
+          continue;
+        }
+
+        int new_block = blocks.size();
+        blocks.push_back({blocks[b].begin,
+                          blocks[b].begin + blocks[b].marked, 0});
+        blocks[b].begin += blocks[b].marked;
+        blocks[b].marked = 0;
+
+        for (int i = blocks[new_block].begin; i < blocks[new_block].end; ++i) {
+          block_of[elems[i]] = new_block;
+        }
+
+        in_worklist.push_back(0);
+        if (in_worklist[b]) {
+          worklist.push_back(new_block);
+          in_worklist[new_block] = 1;
+        } else {
+          int smaller = block_size(new_block) < block_size(b) ? new_block : b;
+          worklist.push_back(smaller);
+          in_worklist[smaller] = 1;
+        }
+      }
+    }
+  }
+
+  // the dead state is dropped, the other states in its block are kept
+  partition_.clear();
+  for (auto &block : blocks) {
+    NumberSet s(node_num);
+    for (int i = block.begin; i < block.end; ++i) {
+      if (dead != elems[i]) {
+        s.insert(elems[i]);
+      }
+    }
+    if (!s.empty()) {
+      partition_.push_back(move(s));
+    }
+  }
+}
+
 shared_ptr<DFA> DFAOptimizer::ConstructFromSets() {
   std::vector<DFANode *> normal_to_min(normal_->size());
 
@@ -413,15 +600,18 @@ shared_ptr<DFA> DFAOptimizer::ConstructFromSets() {
     DFANode *min_u = normal_to_min[*s.begin()];
 
     for (int num : s) {
-      for (auto p : GetNormalNode(num)->edges()) {
-        char c = p.first;
-        DFANode *min_v = normal_to_min[p.second->number()];
-        min_u->AddEdge(c, min_v);
+      auto &edges = GetNormalNode(num)->edges();
+      for (size_t k = 0; k < edges.size(); ++k) {
+        if (edges[k]) {
+          DFANode *min_v = normal_to_min[edges[k]->number()];
+          min_u->AddEdge(k, min_v);
+        }
       }
     }
   }
 
-  return make_shared<DFA>(start, move(ends), move(nodes));
+  return make_shared<DFA>(start, move(ends), move(nodes),
+                          normal_->char_classes());
 }
 
 shared_ptr<DFA> DFAOptimizer::Minimize() {
@@ -432,12 +622,98 @@ shared_ptr<DFA> DFAOptimizer::Minimize() {
     return normal_;
   }
 
-  TryPartEachSet();
+  if (kHopcroft == method_) {
+    RefineByHopcroft();
+  } else {
+    TryPartEachSet();
+  }
 
   auto minimum = ConstructFromSets();
   return minimum;
 }
 
+
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief   the threads of NFA simulation at one position, stored densely in
+ *          the order they are added. A node holds at most one thread, which is
+ *          checked by a generation stamp, so the list is cleared in O(1).
+ */
+class NFAThreadList {
+ public:
+  struct Thread {
+    const NFANode *node;
+    const char *start;
+  };
+
+  NFAThreadList(size_t capacity) : stamps_(capacity, 0) {
+    threads_.reserve(capacity);
+  }
+
+  void clear() {
+    threads_.clear();
+    if (0 == ++generation_) {
+      // wrap around, the old stamps should not be confused with new ones
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      generation_ = 1;
+    }
+  }
+
+  bool empty() const {
+    return threads_.empty();
+  }
+
+  vector<Thread> &threads() {
+    return threads_;
+  }
+
+  /**
+   * @brief     add the node and its epsilon closure, the nodes already held by
+   *            earlier threads are skipped
+   */
+  void Add(const NFANode *node, const char *start) {
+    closure_stack_.push_back(node);
+
+    while (!closure_stack_.empty()) {
+      const NFANode *u = closure_stack_.back();
+      closure_stack_.pop_back();
+
+      unsigned &stamp = stamps_[u->number()];
+      if (stamp == generation_) {
+        continue;
+      }
+      stamp = generation_;
+      threads_.push_back({u, start});
+
+      for (NFAEdge *edge : u->edges()) {
+        if (edge->IsEpsilon()) {
+          closure_stack_.push_back(edge->next_node());
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief     move the threads of other list through the char c
+   */
+  void Step(const NFAThreadList &other, char c) {
+    for (auto &thread : other.threads_) {
+      for (NFAEdge *edge : thread.node->edges()) {
+        if (!edge->IsEpsilon() && edge->test(c)) {
+          Add(edge->next_node(), thread.start);
+        }
+      }
+    }
+  }
+
+ private:
+  vector<Thread> threads_;
+  vector<unsigned> stamps_;
+  unsigned generation_{1};
+  vector<const NFANode *> closure_stack_;
+};
+
 } // end of anonymous namespace
 
 
@@ -470,6 +746,8 @@ string to_string(const NFAEdge &edge) {
  * class Node
  */
 
+constexpr int Node::kUnsetInt;
+
 void Node::AttachState(State state) {
   if ((kStart == state_ && kEnd == state)
       || (kStart == state && kEnd == state_)) {
@@ -624,6 +902,33 @@ NFA *NFAManager::BuildNFA(NFAComponent *comp) {
 }
 
 
+/*----------------------------------------------------------------------------*/
+/**
+ * class CharClasses
+ */
+
+constexpr size_t CharClasses::kByteNum;
+
+void CharClasses::Refine(const NFAEdge::CharMasks &masks) {
+  // a class is split into two new ones, the bytes in masks or not
+  std::vector<int> new_class(size() * 2, -1);
+  std::vector<unsigned char> new_representatives;
+
+  for (size_t b = 0; b < kByteNum; ++b) {
+    bool in_masks = b < masks.size() && masks.test(b);
+    int &k = new_class[byte_to_class_[b] * 2 + in_masks];
+
+    if (-1 == k) {
+      k = new_representatives.size();
+      new_representatives.push_back(static_cast<unsigned char>(b));
+    }
+    byte_to_class_[b] = static_cast<uint8_t>(k);
+  }
+
+  representatives_ = move(new_representatives);
+}
+
+
 /*----------------------------------------------------------------------------*/
 /**
  * class NFA
@@ -632,6 +937,22 @@ NFA *NFAManager::BuildNFA(NFAComponent *comp) {
 NFA::NFA(NFANode *start) : start_(start) {
   unordered_set<NFANode *> visits;
   CollectNodes(start, visits);
+  ComputeCharClasses();
+}
+
+void NFA::ComputeCharClasses() {
+  unordered_set<NFAEdge::CharMasks> all_masks;
+  for (NFANode *u : nodes_) {
+    for (NFAEdge *edge : u->edges()) {
+      if (!edge->IsEpsilon()) {
+        all_masks.insert(edge->char_masks());
+      }
+    }
+  }
+
+  for (auto &masks : all_masks) {
+    char_classes_.Refine(masks);
+  }
 }
 
 void NFA::CollectNodes(NFANode *u, std::unordered_set<NFANode *> &visits) {
@@ -647,53 +968,77 @@ void NFA::CollectNodes(NFANode *u, std::unordered_set<NFANode *> &visits) {
   }
 }
 
-const char *
-NFA::MatchDFS(NFANode *curr, const char *beg, const char *end) const {
-  logger.debug("{}(): {}", __func__, to_string(*curr));
-
-  if (curr->IsEnd()) {
-    // recurse base, arrive END state
-    return beg;
+bool NFA::Match(const char *beg, const char *end) const {
+  NFAThreadList curr(nodes_.size());
+  NFAThreadList next(nodes_.size());
+  curr.Add(start_, beg);
+
+  for (const char *s = beg; s != end; ++s) {
+    next.clear();
+    next.Step(curr, *s);
+    if (next.empty()) {
+      return false;
+    }
+    std::swap(curr, next);
   }
 
-  for (NFAEdge *edge : curr->edges()) {
-    const char *match_pos = nullptr;
+  for (auto &thread : curr.threads()) {
+    if (thread.node->IsEnd()) {
+      return true;
+    }
+  }
+  return false;
+}
 
-    if (edge->IsEpsilon()) {
-      // epsilon move
-      match_pos = MatchDFS(edge->next_node(), beg, end);
+bool NFA::Match(const std::string &s) const {
+  return Match(s.c_str(), s.c_str() + s.length());
+}
 
-    } else if (edge->test(*beg) && beg < end) {
-      // match
-      match_pos = MatchDFS(edge->next_node(), beg + 1, end);
+const char *NFA::Search(const char *begin, const char *end) const {
+  const char *match_end = nullptr;
+  return Search(begin, end, match_end);
+}
 
-    } else {
-      // skip
-      continue;
+const char *NFA::Search(const char *begin, const char *end,
+                        const char *&match_end) const {
+  NFAThreadList curr(nodes_.size());
+  NFAThreadList next(nodes_.size());
+
+  const char *match_begin = nullptr;
+  curr.Add(start_, begin);
+
+  for (const char *s = begin; ; ++s) {
+    auto &threads = curr.threads();
+    for (auto &thread : threads) {
+      if (thread.node->IsEnd()) {
+        if (!match_begin || thread.start <= match_begin) {
+          match_begin = thread.start;
+          match_end = s;
+        }
+        break;
+      }
     }
 
-    if (match_pos == end) {
-      return match_pos;
+    if (match_begin) {
+      // the threads starting after the match could not be leftmost
+      while (!threads.empty() && threads.back().start > match_begin) {
+        threads.pop_back();
+      }
     }
-  }
-
-  return nullptr;
-}
 
-bool NFA::Match(const char *beg, const char *end) const {
-  logger.debug("{}(): {}", __func__, beg);
-  return (MatchDFS(start_, beg, end) == end);
-}
+    if (end == s || (match_begin && threads.empty())) {
+      break;
+    }
 
-const char *
-NFA::SearchDFS(NFANode *curr, const char *beg, const char *end) const {
-  // TODO
-  return nullptr;
-}
+    next.clear();
+    next.Step(curr, *s);
+    if (!match_begin) {
+      next.Add(start_, s + 1);
+    }
+    std::swap(curr, next);
+  }
 
-const char *NFA::Search(const char *begin, const char *end) const {
-  // TODO
-  return nullptr;
+  return match_begin;
 }
 
 // for debug
@@ -722,17 +1067,64 @@ void PrintNFA(const NFA *nfa) {
  * class NumberSet
  */
 
+constexpr size_t NumberSet::kWordBits;
+
 size_t NumberSet::Hasher::operator()(const NumberSet &num_set) const {
-  size_t value = 0;
-  for (int num : num_set.set()) {
-    value |= num % sizeof(size_t);
+  auto &words = num_set.words_;
+
+  // the trailing empty words do not affect the equality, so as the hash value
+  size_t last = words.size();
+  while (0 < last && 0 == words[last - 1]) {
+    last -= 1;
+  }
+
+  uint64_t value = 0;
+  for (size_t i = 0; i < last; ++i) {
+    // the finalizer of splitmix64
+    uint64_t x = words[i] + value + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    value = x ^ (x >> 31);
+  }
+  return static_cast<size_t>(value);
+}
+
+void NumberSet::insert(const NumberSet &num_set) {
+  auto &other = num_set.words_;
+  if (words_.size() < other.size()) {
+    words_.resize(other.size(), 0);
+  }
+
+  size_ = 0;
+  for (size_t i = 0; i < words_.size(); ++i) {
+    if (i < other.size()) {
+      words_[i] |= other[i];
+    }
+    size_ += __builtin_popcountll(words_[i]);
+  }
+}
+
+bool operator==(const NumberSet &lhs, const NumberSet &rhs) {
+  if (lhs.size_ != rhs.size_) {
+    return false;
+  }
+
+  auto &short_words = lhs.words_.size() < rhs.words_.size() ? lhs.words_
+                                                            : rhs.words_;
+  auto &long_words = lhs.words_.size() < rhs.words_.size() ? rhs.words_
+                                                           : lhs.words_;
+  for (size_t i = 0; i < short_words.size(); ++i) {
+    if (short_words[i] != long_words[i]) {
+      return false;
+    }
   }
-  return value;
+  // the rest words of the longer one must be empty since the sizes are equal
+  return true;
 }
 
 std::string to_string(const NumberSet &num_set) {
   std::string str{"{"};
-  for (int num : num_set.set()) {
+  for (int num : num_set) {
     str += std::to_string(num);
   }
   str += '}';
@@ -749,6 +1141,60 @@ string to_string(const set<int> &num_set) {
   return str;
 }
 
+/*----------------------------------------------------------------------------*/
+/**
+ * class DFATable
+ */
+
+constexpr int DFATable::kDeadState;
+
+DFATable::DFATable(const DFA *dfa)
+    : size_(dfa->size()), class_num_(dfa->char_classes().size()) {
+
+  struct Storage {
+    std::array<uint8_t, CharClasses::kByteNum> byte_to_class;
+    vector<int> transitions;
+    vector<int> priorities;
+    vector<uint8_t> ends;
+  };
+
+  auto storage = make_shared<Storage>();
+  storage->byte_to_class = dfa->char_classes().byte_to_class();
+  storage->transitions.assign(size_ * class_num_, kDeadState);
+  storage->priorities.assign(size_, Node::kUnsetInt);
+  storage->ends.assign(size_, 0);
+
+  if (dfa->start()) {
+    start_ = dfa->start()->number();
+  }
+
+  for (size_t i = 0; i < size_; ++i) {
+    const DFANode *u = dfa->GetNode(i);
+    storage->ends[i] = u->IsEnd();
+    storage->priorities[i] = u->priority();
+
+    int *row = &storage->transitions[i * class_num_];
+    auto &edges = u->edges();
+    for (size_t k = 0; k < edges.size(); ++k) {
+      if (edges[k]) {
+        row[k] = edges[k]->number();
+      }
+    }
+  }
+
+  byte_to_class_ = storage->byte_to_class.data();
+  transitions_ = storage->transitions.data();
+  priorities_ = storage->priorities.data();
+  ends_ = storage->ends.data();
+  storage_ = storage;
+}
+
+const char *DFATable::Search(const char *begin, const char *end,
+                             const char *&match_end) const {
+  return SearchLeftmostLongest(*this, begin, end, match_end);
+}
+
+
 /*----------------------------------------------------------------------------*/
 /**
  * class DFA
@@ -761,24 +1207,17 @@ void DFA::NumberNode() {
 }
 
 bool DFA::Match(const char *beg, const char *end) const {
-  const char *s = beg;
-  const DFANode *curr_node = start_;
-
-  logger.debug("{}", to_string(*curr_node));
-  while (s != end) {
-    const DFANode *next_node = curr_node->GetNextNode(*s);
-
-    if (next_node) {
-      curr_node = next_node;
-      s += 1;
-      logger.debug("{}", to_string(*curr_node));
+  const DFATable &table = *table_;
+  int curr_state = table.start();
 
-    } else {
+  for (const char *s = beg; s != end; ++s) {
+    curr_state = table.GetNextState(curr_state, *s);
+    if (DFATable::kDeadState == curr_state) {
       return false;
     }
   }
 
-  return curr_node->IsEnd();
+  return table.IsEnd(curr_state);
 }
 
 bool DFA::Match(const std::string &s) const {
@@ -786,20 +1225,216 @@ bool DFA::Match(const std::string &s) const {
 }
 
 const char *DFA::Search(const char *begin, const char *end) const {
-  // TODO
-  return nullptr;
+  const char *match_end = nullptr;
+  return Search(begin, end, match_end);
+}
+
+const char *DFA::Search(const char *begin, const char *end,
+                        const char *&match_end) const {
+  return table_->Search(begin, end, match_end);
 }
 
 size_t DFA::Search(const std::string &s) const {
-  return -1;
+  const char *match_begin = Search(s.c_str(), s.c_str() + s.length());
+  return match_begin ? match_begin - s.c_str() : std::string::npos;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * class LazyDFA
+ */
+
+constexpr int LazyDFA::kDeadState;
+constexpr int LazyDFA::kUnknownState;
+constexpr size_t LazyDFA::kDefaultCacheBudget;
+constexpr size_t LazyDFA::kDefaultMaxFlushes;
+
+LazyDFA::LazyDFA(const NFA *nfa,
+                 std::shared_ptr<NFAManager> nfa_manager,
+                 size_t cache_budget,
+                 size_t max_flushes)
+    : nfa_(nfa), nfa_manager_(nfa_manager), cache_budget_(cache_budget),
+      max_flushes_(max_flushes), class_num_(nfa->char_classes().size()),
+      // the transitions row, the bits of NFA states and the map entry
+      state_bytes_(class_num_ * sizeof(int) + (nfa->size() + 63) / 64 * 8
+                       + sizeof(NumberSet) + 4 * sizeof(void *)) {}
+
+void LazyDFA::AddClosure(NumberSet &nfa_states, const NFANode *node) const {
+  vector<const NFANode *> closure_stack{node};
+
+  while (!closure_stack.empty()) {
+    const NFANode *u = closure_stack.back();
+    closure_stack.pop_back();
+    if (!nfa_states.insert(u->number())) {
+      continue;
+    }
+
+    for (NFAEdge *edge : u->edges()) {
+      if (edge->IsEpsilon()) {
+        closure_stack.push_back(edge->next_node());
+      }
+    }
+  }
+}
+
+int LazyDFA::Intern(NumberSet &&nfa_states) const {
+  auto iter = state_map_.find(nfa_states);
+  if (state_map_.end() != iter) {
+    return iter->second;
+  }
+
+  int state = states_.size();
+  bool is_end = false;
+  for (int num : nfa_states) {
+    if (nfa_->GetNode(num)->IsEnd()) {
+      is_end = true;
+      break;
+    }
+  }
+
+  iter = state_map_.emplace(move(nfa_states), state).first;
+  states_.push_back(&iter->first);
+  ends_.push_back(is_end);
+  transitions_.resize(transitions_.size() + class_num_, kUnknownState);
+  cache_bytes_ += state_bytes_;
+  return state;
+}
+
+int LazyDFA::ComputeNextState(int state, int char_class) const {
+  char c = nfa_->char_classes().GetRepresentative(char_class);
+
+  NumberSet next_states(nfa_->size());
+  for (int num : *states_[state]) {
+    for (NFAEdge *edge : nfa_->GetNode(num)->edges()) {
+      if (!edge->IsEpsilon() && edge->test(c)) {
+        AddClosure(next_states, edge->next_node());
+      }
+    }
+  }
+
+  if (next_states.empty()) {
+    return kDeadState;
+  }
+
+  if (state_map_.end() == state_map_.find(next_states)
+      && cache_bytes_ + state_bytes_ > cache_budget_) {
+    is_overflowed_ = true;
+    return kDeadState;
+  }
+  return Intern(move(next_states));
+}
+
+void LazyDFA::Flush() const {
+  state_map_.clear();
+  states_.clear();
+  ends_.clear();
+  transitions_.clear();
+  start_ = kUnknownState;
+  cache_bytes_ = 0;
+  is_overflowed_ = false;
+  flush_count_ += 1;
+}
+
+int LazyDFA::start() const {
+  if (kUnknownState == start_) {
+    NumberSet start_states(nfa_->size());
+    AddClosure(start_states, nfa_->start());
+    start_ = Intern(move(start_states));
+  }
+  return start_;
+}
+
+int LazyDFA::GetNextState(int state, char c) const {
+  if (is_overflowed_) {
+    // the result will be dropped, stop computing new states
+    return kDeadState;
+  }
+
+  int char_class = nfa_->char_classes().GetClass(c);
+  size_t index = state * class_num_ + char_class;
+  if (kUnknownState == transitions_[index]) {
+    int next_state = ComputeNextState(state, char_class);
+    if (is_overflowed_) {
+      return kDeadState;
+    }
+    transitions_[index] = next_state;
+  }
+  return transitions_[index];
+}
+
+bool LazyDFA::Match(const char *beg, const char *end) const {
+  size_t flushes = 0;
+  int curr_state = start();
+
+  for (const char *s = beg; s != end; ++s) {
+    int next_state = GetNextState(curr_state, *s);
+
+    if (is_overflowed_) {
+      // keep only the current state and go on
+      NumberSet curr_states = *states_[curr_state];
+      Flush();
+      if (++flushes > max_flushes_) {
+        fallback_count_ += 1;
+        return nfa_->Match(beg, end);
+      }
+
+      curr_state = Intern(move(curr_states));
+      next_state = GetNextState(curr_state, *s);
+      if (is_overflowed_) {
+        // the budget could not hold even two states
+        Flush();
+        fallback_count_ += 1;
+        return nfa_->Match(beg, end);
+      }
+    }
+
+    if (kDeadState == next_state) {
+      return false;
+    }
+    curr_state = next_state;
+  }
+
+  return IsEnd(curr_state);
+}
+
+bool LazyDFA::Match(const std::string &s) const {
+  return Match(s.c_str(), s.c_str() + s.length());
+}
+
+const char *LazyDFA::Search(const char *begin, const char *end) const {
+  const char *match_end = nullptr;
+  return Search(begin, end, match_end);
+}
+
+const char *LazyDFA::Search(const char *begin, const char *end,
+                            const char *&match_end) const {
+  const char *match_begin =
+      SearchLeftmostLongest(*this, begin, end, match_end);
+
+  if (is_overflowed_) {
+    // the states of threads are lost by flushing, search again by NFA
+    Flush();
+    fallback_count_ += 1;
+    return nfa_->Search(begin, end, match_end);
+  }
+  return match_begin;
+}
+
+size_t LazyDFA::Search(const std::string &s) const {
+  const char *match_begin = Search(s.c_str(), s.c_str() + s.length());
+  return match_begin ? match_begin - s.c_str() : std::string::npos;
 }
 
 static void PrintDFARecur(const DFANode *u, std::vector<bool> &visit) {
   visit[u->number()] = true;
 
-  for (auto p : u->edges()) {
-    DFANode *v = p.second;
-    logger.log("{}--{}--{}", to_string(*u), p.first, to_string(*v));
+  auto &edges = u->edges();
+  for (size_t k = 0; k < edges.size(); ++k) {
+    DFANode *v = edges[k];
+    if (!v) {
+      continue;
+    }
+    logger.log("{}--[{}]--{}", to_string(*u), k, to_string(*v));
 
     if (!visit[v->number()]) {
       PrintDFARecur(v, visit);
@@ -814,8 +1449,9 @@ void PrintDFA(const DFA *dfa) {
 
 /*----------------------------------------------------------------------------*/
 
-std::shared_ptr<DFA> MinimizeDFA(const shared_ptr<DFA> normal) {
-  return DFAOptimizer(normal).Minimize();
+std::shared_ptr<DFA> MinimizeDFA(const shared_ptr<DFA> normal,
+                                 MinimizeMethod method) {
+  return DFAOptimizer(normal, method).Minimize();
 }
 
 std::shared_ptr<DFA> ConvertNFAToDFA(const NFA *nfa) {
@@ -17,8 +17,11 @@
 
 #include <climits>
 #include <cassert>
+#include <cstdint>
 
 #include <algorithm>
+#include <array>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <bitset>
@@ -55,6 +58,10 @@ class NumberSet;
 
 class DFA;
 
+class DFATable;
+
+class CharClasses;
+
 /**
  * type definition, some memory manager.
  */
@@ -80,12 +87,22 @@ void PrintNFA(const NFA *nfa);
 
 void PrintDFA(const DFA *dfa);
 
+/**
+ * algorithms used to minimize DFA
+ */
+enum MinimizeMethod {
+  kIterativeRefine,   // split every block repeatedly until nothing changes
+  kHopcroft,          // Hopcroft's partition refinement, O(n*|class|*log n)
+};
+
 /**
  * @param normal    the DFA to be minimized
+ * @param method    the algorithm used to refine the partition
  * @return          the minimum DFA, may be the same one if the parameter has
  *                  already minimum DFA
  */
-std::shared_ptr<DFA> MinimizeDFA(const std::shared_ptr<DFA> normal);
+std::shared_ptr<DFA> MinimizeDFA(const std::shared_ptr<DFA> normal,
+                                 MinimizeMethod method = kHopcroft);
 
 /**
  * @param nfa   the NFA to be converted
@@ -128,7 +145,8 @@ class NFAEdge {
   }
 
   bool test(char c) const {
-    return char_masks_.test(c);
+    auto index = static_cast<unsigned char>(c);
+    return index < char_masks_.size() && char_masks_.test(index);
   }
 
   const CharMasks &char_masks() const {
@@ -253,25 +271,30 @@ class DFANode : public Node {
  public:
   DFANode(State state) : Node(state) {}
 
-  const std::unordered_map<char, DFANode *> &edges() const {
+  /**
+   * @return    the edges indexed by char class, nullptr if there is no edge
+   */
+  const std::vector<DFANode *> &edges() const {
     return edges_;
   };
 
-  void AddEdge(char c, DFANode *node) {
-    edges_[c] = node;
+  void AddEdge(int char_class, DFANode *node) {
+    if (edges_.size() <= static_cast<size_t>(char_class)) {
+      edges_.resize(char_class + 1, nullptr);
+    }
+    edges_[char_class] = node;
   }
 
-  const DFANode *GetNextNode(char c) const {
-    auto iter = edges_.find(c);
-    if (edges_.end() == iter) {
+  const DFANode *GetNextNode(int char_class) const {
+    if (edges_.size() <= static_cast<size_t>(char_class)) {
       return nullptr;
     } else {
-      return iter->second;
+      return edges_[char_class];
     }
   }
 
  private:
-  std::unordered_map<char, DFANode *> edges_;
+  std::vector<DFANode *> edges_;
 };
 
 
@@ -385,6 +408,55 @@ class NFAManager : SmallObjPool<NFA> {
 };
 
 
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief   equivalence classes of the input bytes. Bytes in the same class
+ *          could not be distinguished by any edge of an NFA, so that the DFA
+ *          only needs one transition for each class.
+ */
+class CharClasses {
+ public:
+  constexpr static size_t kByteNum{UCHAR_MAX + 1};
+
+  /**
+   * @brief     all the bytes are in the same class initially
+   */
+  CharClasses() : representatives_(1, 0) {
+    byte_to_class_.fill(0);
+  }
+
+  /**
+   * @brief     split the classes so that the bytes in masks and the bytes not
+   *            in masks never share a class
+   */
+  void Refine(const NFAEdge::CharMasks &masks);
+
+  size_t size() const {
+    return representatives_.size();
+  }
+
+  int GetClass(char c) const {
+    return byte_to_class_[static_cast<unsigned char>(c)];
+  }
+
+  /**
+   * @return    one of the bytes in this class
+   */
+  char GetRepresentative(int char_class) const {
+    return static_cast<char>(representatives_[char_class]);
+  }
+
+  const std::array<uint8_t, kByteNum> &byte_to_class() const {
+    return byte_to_class_;
+  }
+
+ private:
+  std::array<uint8_t, kByteNum> byte_to_class_;
+  std::vector<unsigned char> representatives_;
+};
+
+
 /*----------------------------------------------------------------------------*/
 
 /**
@@ -394,10 +466,26 @@ class NFA {
  public:
   NFA(NFANode *start);
 
+  /**
+   * @brief     simulate all the NFA states at once, linear to the length of
+   *            string. Could be used when the DFA is too large to construct.
+   */
   bool Match(const char *beg, const char *end) const;
 
+  bool Match(const std::string &s) const;
+
+  /**
+   * @return    the begin of the leftmost-longest match, or nullptr
+   */
   const char *Search(const char *begin, const char *end) const;
 
+  /**
+   * @param match_end   set to the end of the match if found
+   * @return            the begin of the leftmost-longest match, or nullptr
+   */
+  const char *Search(const char *begin, const char *end,
+                     const char *&match_end) const;
+
   const NFANode *start() const {
     return start_;
   }
@@ -410,74 +498,245 @@ class NFA {
     return nodes_[number];
   }
 
+  const CharClasses &char_classes() const {
+    return char_classes_;
+  }
+
  private:
   void CollectNodes(NFANode *start, std::unordered_set<NFANode *> &visits);
 
-  const char *MatchDFS(NFANode *curr, const char *beg, const char *end) const;
-
-  const char *SearchDFS(NFANode *curr, const char *beg, const char *end) const;
+  void ComputeCharClasses();
 
  private:
   NFANode *start_{nullptr};
   std::vector<NFANode *> nodes_;
+  CharClasses char_classes_;
 };
 
 
 /*----------------------------------------------------------------------------*/
 
 /**
- * @brief   a set contains number, support hashing and sharing with others
+ * @brief   a set contains small non-negative numbers, stored as a dense
+ *          bitset so that inserting, merging and hashing are cheap
  */
 class NumberSet {
+ private:
+  typedef uint64_t Word;
+  constexpr static size_t kWordBits{64};
+
  public:
   struct Hasher {
     size_t operator()(const NumberSet &num_set) const;
   };
 
+  /**
+   * @brief   iterate the numbers in ascending order
+   */
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef int value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const int *pointer;
+    typedef int reference;
+
+    const_iterator(const std::vector<Word> *words, size_t index)
+        : words_(words), index_(index),
+          bits_(index < words->size() ? (*words)[index] : 0) {
+      SkipEmptyWords();
+    }
+
+    int operator*() const {
+      return static_cast<int>(index_ * kWordBits + __builtin_ctzll(bits_));
+    }
+
+    const_iterator &operator++() {
+      // clear the lowest bit
+      bits_ &= bits_ - 1;
+      SkipEmptyWords();
+      return *this;
+    }
+
+    bool operator==(const const_iterator &rhs) const {
+      return index_ == rhs.index_ && bits_ == rhs.bits_;
+    }
+
+    bool operator!=(const const_iterator &rhs) const {
+      return !operator==(rhs);
+    }
+
+   private:
+    void SkipEmptyWords() {
+      while (0 == bits_ && index_ < words_->size()) {
+        index_ += 1;
+        bits_ = index_ < words_->size() ? (*words_)[index_] : 0;
+      }
+    }
+
+    const std::vector<Word> *words_;
+    size_t index_;
+    Word bits_;
+  };
+
  public:
-  NumberSet() : pset_(std::make_shared<std::set<int>>()) {}
+  NumberSet() = default;
 
-  const std::set<int> &set() const {
-    return *pset_;
-  }
+  /**
+   * @param capacity    the numbers are expected to be less than it
+   */
+  explicit NumberSet(size_t capacity)
+      : words_((capacity + kWordBits - 1) / kWordBits, 0) {}
 
-  std::set<int>::const_iterator begin() const {
-    return pset_->begin();
+  const_iterator begin() const {
+    return const_iterator(&words_, 0);
   }
 
-  std::set<int>::const_iterator end() const {
-    return pset_->end();
+  const_iterator end() const {
+    return const_iterator(&words_, words_.size());
   }
 
   bool empty() const {
-    return pset_->empty();
+    return 0 == size_;
+  }
+
+  size_t size() const {
+    return size_;
   }
 
   bool contains(int num) const {
-    return pset_->end() != pset_->find(num);
+    size_t index = num / kWordBits;
+    return index < words_.size()
+        && (words_[index] >> (num % kWordBits) & 1);
   }
 
   bool insert(int num) {
-    return pset_->insert(num).second;
-  }
+    size_t index = num / kWordBits;
+    if (words_.size() <= index) {
+      words_.resize(index + 1, 0);
+    }
 
-  void insert(const NumberSet &num_set) {
-    pset_->insert(num_set.begin(), num_set.end());
+    Word bit = Word(1) << (num % kWordBits);
+    if (words_[index] & bit) {
+      return false;
+    }
+    words_[index] |= bit;
+    size_ += 1;
+    return true;
   }
 
+  void insert(const NumberSet &num_set);
+
+  friend bool operator==(const NumberSet &lhs, const NumberSet &rhs);
+
  private:
-  std::shared_ptr<std::set<int>> pset_;
+  std::vector<Word> words_;
+  size_t size_{0};
 };
 
-inline bool operator==(const NumberSet &lhs, const NumberSet &rhs) {
-  return lhs.set() == rhs.set();
-}
+bool operator==(const NumberSet &lhs, const NumberSet &rhs);
 
 inline bool operator!=(const NumberSet &lhs, const NumberSet &rhs) {
   return !(lhs == rhs);
 }
 
 
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief   compiled form of DFA, the transitions are stored in a contiguous
+ *          table indexed by state number and char class. The accept flags
+ *          and priorities are stored alongside.
+ *
+ * The table only views the arrays, which are kept alive by the storage. So
+ * it could be compiled from DFA or mapped from a file.
+ */
+class DFATable {
+ public:
+  constexpr static int kDeadState{-1};
+
+  DFATable(const DFA *dfa);
+
+  /**
+   * @brief     view the arrays stored outside, such as a mapped file
+   * @param storage     keep the memory of arrays alive
+   */
+  DFATable(size_t size, int start, size_t class_num,
+           const uint8_t *byte_to_class,
+           const int *transitions,
+           const int *priorities,
+           const uint8_t *ends,
+           std::shared_ptr<const void> storage)
+      : size_(size), start_(start), class_num_(class_num),
+        byte_to_class_(byte_to_class), transitions_(transitions),
+        priorities_(priorities), ends_(ends), storage_(std::move(storage)) {}
+
+  size_t size() const {
+    return size_;
+  }
+
+  int start() const {
+    return start_;
+  }
+
+  /**
+   * @return    the number of columns of each state
+   */
+  size_t class_num() const {
+    return class_num_;
+  }
+
+  int GetNextState(int state, char c) const {
+    return transitions_[state * class_num_
+        + byte_to_class_[static_cast<unsigned char>(c)]];
+  }
+
+  bool IsEnd(int state) const {
+    return ends_[state];
+  }
+
+  int priority(int state) const {
+    return priorities_[state];
+  }
+
+  /**
+   * @brief     the raw arrays, used to serialize the table
+   */
+  const uint8_t *byte_to_class() const {
+    return byte_to_class_;
+  }
+
+  const int *transitions() const {
+    return transitions_;
+  }
+
+  const int *priorities() const {
+    return priorities_;
+  }
+
+  const uint8_t *ends() const {
+    return ends_;
+  }
+
+  /**
+   * @param match_end   set to the end of the match if found
+   * @return            the begin of the leftmost-longest match, or nullptr
+   */
+  const char *Search(const char *begin, const char *end,
+                     const char *&match_end) const;
+
+ private:
+  size_t size_{0};
+  int start_{kDeadState};
+  size_t class_num_{0};
+  const uint8_t *byte_to_class_{nullptr};
+  const int *transitions_{nullptr};
+  const int *priorities_{nullptr};
+  const uint8_t *ends_{nullptr};
+  std::shared_ptr<const void> storage_;
+};
+
+
 /*----------------------------------------------------------------------------*/
 
 /**
@@ -487,9 +746,12 @@ class DFA {
  public:
   DFA(DFANode *start,
       std::vector<DFANode *> &&ends,
-      std::vector<DFANode *> &&nodes)
-      : start_(start), ends_(std::move(ends)), nodes_(std::move(nodes)) {
+      std::vector<DFANode *> &&nodes,
+      const CharClasses &char_classes)
+      : start_(start), ends_(std::move(ends)), nodes_(std::move(nodes)),
+        char_classes_(char_classes) {
     NumberNode();
+    table_ = std::make_shared<DFATable>(this);
   }
 
   ~DFA() {
@@ -510,12 +772,39 @@ class DFA {
     return nodes_[number];
   }
 
+  /**
+   * @return the char classes which the edges are labeled with
+   */
+  const CharClasses &char_classes() const {
+    return char_classes_;
+  }
+
+  /**
+   * @return the transition table compiled from the nodes
+   */
+  std::shared_ptr<const DFATable> table() const {
+    return table_;
+  }
+
   bool Match(const char *beg, const char *end) const;
 
   bool Match(const std::string &s) const;
 
+  /**
+   * @return    the begin of the leftmost-longest match, or nullptr
+   */
   const char *Search(const char *begin, const char *end) const;
 
+  /**
+   * @param match_end   set to the end of the match if found
+   * @return            the begin of the leftmost-longest match, or nullptr
+   */
+  const char *Search(const char *begin, const char *end,
+                     const char *&match_end) const;
+
+  /**
+   * @return    the position of the leftmost-longest match, or npos
+   */
   size_t Search(const std::string &s) const;
 
  private:
@@ -525,8 +814,317 @@ class DFA {
   DFANode *start_{nullptr};
   std::vector<DFANode *> ends_;
   std::vector<DFANode *> nodes_;
+  CharClasses char_classes_;
+  std::shared_ptr<DFATable> table_;
 };
 
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief   DFA constructed on demand. A DFA state is determinized from the NFA
+ *          when it is first visited by Match or Search, and cached until the
+ *          cache exceeds the byte budget. Then the cache is flushed, and after
+ *          too many flushes in one call, it falls back to NFA simulation.
+ *
+ * The cache is mutated by the const member functions, so an instance should
+ * not be shared between threads.
+ */
+class LazyDFA {
+ public:
+  constexpr static int kDeadState{-1};
+  constexpr static size_t kDefaultCacheBudget{1 << 20};
+  constexpr static size_t kDefaultMaxFlushes{4};
+
+  /**
+   * @param nfa             the NFA to be determinized
+   * @param nfa_manager     keep the memory of NFA alive, could be nullptr
+   * @param cache_budget    the max bytes of the cached states
+   * @param max_flushes     the max flushes in a call before falling back
+   */
+  LazyDFA(const NFA *nfa,
+          std::shared_ptr<NFAManager> nfa_manager = nullptr,
+          size_t cache_budget = kDefaultCacheBudget,
+          size_t max_flushes = kDefaultMaxFlushes);
+
+  bool Match(const char *beg, const char *end) const;
+
+  bool Match(const std::string &s) const;
+
+  /**
+   * @return    the begin of the leftmost-longest match, or nullptr
+   */
+  const char *Search(const char *begin, const char *end) const;
+
+  /**
+   * @param match_end   set to the end of the match if found
+   * @return            the begin of the leftmost-longest match, or nullptr
+   */
+  const char *Search(const char *begin, const char *end,
+                     const char *&match_end) const;
+
+  /**
+   * @return    the position of the leftmost-longest match, or npos
+   */
+  size_t Search(const std::string &s) const;
+
+  int start() const;
+
+  int GetNextState(int state, char c) const;
+
+  bool IsEnd(int state) const {
+    return ends_[state];
+  }
+
+  /**
+   * @return    the number of cached states
+   */
+  size_t size() const {
+    return ends_.size();
+  }
+
+  size_t cache_bytes() const {
+    return cache_bytes_;
+  }
+
+  size_t flush_count() const {
+    return flush_count_;
+  }
+
+  size_t fallback_count() const {
+    return fallback_count_;
+  }
+
+ private:
+  int Intern(NumberSet &&nfa_states) const;
+
+  int ComputeNextState(int state, int char_class) const;
+
+  void AddClosure(NumberSet &nfa_states, const NFANode *node) const;
+
+  void Flush() const;
+
+ private:
+  constexpr static int kUnknownState{-2};
+
+  const NFA *nfa_;
+  std::shared_ptr<NFAManager> nfa_manager_;
+  const size_t cache_budget_;
+  const size_t max_flushes_;
+  const size_t class_num_;
+  const size_t state_bytes_;
+
+  // the cache
+  mutable std::unordered_map<NumberSet, int, NumberSet::Hasher> state_map_;
+  mutable std::vector<const NumberSet *> states_;
+  mutable std::vector<uint8_t> ends_;
+  mutable std::vector<int> transitions_;
+  mutable int start_{kUnknownState};
+  mutable size_t cache_bytes_{0};
+  mutable bool is_overflowed_{false};
+
+  // statistics
+  mutable size_t flush_count_{0};
+  mutable size_t fallback_count_{0};
+};
+
+
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief   leftmost-longest search by simulating the automaton from all the
+ *          positions at once. Each thread remembers where it starts, and
+ *          only the earliest thread stays on a state, so the time is linear
+ *          to the length of text.
+ *
+ * The Automaton should provide start(), GetNextState(state, c) and
+ * IsEnd(state), the states are non-negative integers and a negative one means
+ * no transition.
+ */
+template<class Automaton>
+const char *SearchLeftmostLongest(Automaton &automaton,
+                                  const char *begin, const char *end,
+                                  const char *&match_end) {
+  struct Thread {
+    int state;
+    const char *start;
+  };
+
+  std::vector<Thread> curr_threads;
+  std::vector<Thread> next_threads;
+  std::vector<unsigned> stamps;
+  unsigned generation = 1;
+
+  // the threads are added in order of the start positions
+  auto add_thread = [&](std::vector<Thread> &threads, int state,
+                        const char *start) {
+    if (stamps.size() <= static_cast<size_t>(state)) {
+      stamps.resize(state + 1, 0);
+    }
+    if (stamps[state] != generation) {
+      stamps[state] = generation;
+      threads.push_back({state, start});
+    }
+  };
+
+  const char *match_begin = nullptr;
+  add_thread(curr_threads, automaton.start(), begin);
+
+  for (const char *s = begin; ; ++s) {
+    for (auto &thread : curr_threads) {
+      if (automaton.IsEnd(thread.state)) {
+        if (!match_begin || thread.start <= match_begin) {
+          match_begin = thread.start;
+          match_end = s;
+        }
+        break;
+      }
+    }
+
+    if (match_begin) {
+      // the threads starting after the match could not be leftmost
+      while (!curr_threads.empty()
+          && curr_threads.back().start > match_begin) {
+        curr_threads.pop_back();
+      }
+    }
+
+    if (end == s || (match_begin && curr_threads.empty())) {
+      break;
+    }
+
+    generation += 1;
+    next_threads.clear();
+    for (auto &thread : curr_threads) {
+      int next_state = automaton.GetNextState(thread.state, *s);
+      if (next_state >= 0) {
+        add_thread(next_threads, next_state, thread.start);
+      }
+    }
+    if (!match_begin) {
+      add_thread(next_threads, automaton.start(), s + 1);
+    }
+    curr_threads.swap(next_threads);
+  }
+
+  return match_begin;
+}
+
+
+/**
+ * @brief   the range of a match
+ */
+struct MatchResult {
+  const char *begin;
+  const char *end;
+
+  size_t length() const {
+    return end - begin;
+  }
+};
+
+/**
+ * @brief   iterates all the non-overlapping leftmost-longest matches in a
+ *          buffer. The Automaton should provide Search(begin, end, match_end).
+ *          After an empty match the search goes on from the next char.
+ */
+template<class Automaton>
+class MatchIterator {
+ public:
+  typedef std::forward_iterator_tag iterator_category;
+  typedef MatchResult value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef const MatchResult *pointer;
+  typedef const MatchResult &reference;
+
+  /**
+   * construct the end iterator
+   */
+  MatchIterator() = default;
+
+  MatchIterator(const Automaton *automaton, const char *begin, const char *end)
+      : automaton_(automaton), next_(begin), end_(end) {
+    SearchNext();
+  }
+
+  const MatchResult &operator*() const {
+    return match_;
+  }
+
+  const MatchResult *operator->() const {
+    return &match_;
+  }
+
+  MatchIterator &operator++() {
+    SearchNext();
+    return *this;
+  }
+
+  bool operator==(const MatchIterator &rhs) const {
+    return automaton_ == rhs.automaton_ && match_.begin == rhs.match_.begin
+        && match_.end == rhs.match_.end;
+  }
+
+  bool operator!=(const MatchIterator &rhs) const {
+    return !operator==(rhs);
+  }
+
+ private:
+  void SearchNext() {
+    const char *match_end = nullptr;
+    const char *match_begin = next_ <= end_ ?
+                              automaton_->Search(next_, end_, match_end) :
+                              nullptr;
+    if (!match_begin) {
+      *this = MatchIterator();
+      return;
+    }
+
+    match_ = {match_begin, match_end};
+    next_ = match_begin == match_end ? match_end + 1 : match_end;
+  }
+
+  const Automaton *automaton_{nullptr};
+  const char *next_{nullptr};
+  const char *end_{nullptr};
+  MatchResult match_{nullptr, nullptr};
+};
+
+/**
+ * @brief   all the matches in a buffer, used in range-based for loop
+ */
+template<class Automaton>
+class MatchRange {
+ public:
+  MatchRange(const Automaton *automaton, const char *begin, const char *end)
+      : automaton_(automaton), begin_(begin), end_(end) {}
+
+  MatchIterator<Automaton> begin() const {
+    return MatchIterator<Automaton>(automaton_, begin_, end_);
+  }
+
+  MatchIterator<Automaton> end() const {
+    return MatchIterator<Automaton>();
+  }
+
+ private:
+  const Automaton *automaton_;
+  const char *begin_;
+  const char *end_;
+};
+
+template<class Automaton>
+MatchRange<Automaton> SearchAll(const Automaton &automaton,
+                                const char *begin, const char *end) {
+  return MatchRange<Automaton>(&automaton, begin, end);
+}
+
+template<class Automaton>
+MatchRange<Automaton> SearchAll(const Automaton &automaton,
+                                const std::string &s) {
+  return SearchAll(automaton, s.c_str(), s.c_str() + s.length());
+}
+
+
 /*----------------------------------------------------------------------------*/
 
 template<class ...A>
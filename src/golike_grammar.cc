@@ -204,12 +204,8 @@ Tokenizer BuildGolikeTokenizer() {
       .SetLineComment("//")
       .SetBlockComment("/*", "*/")
       .SetIgnoreSet({kSpaceSymbol})
-      .SetPatterns(
+      .SetKeywords(
           {
-              // space
-              {"[ \v\r\f\t]", kSpaceSymbol},
-              {"\n", kLFSymbol},
-              // keywords
               {"break", kBreak},
               {"case", kCase},
               {"const", kConst},
@@ -226,6 +222,12 @@ Tokenizer BuildGolikeTokenizer() {
               {"switch", kSwitch},
               {"type", kType},
               {"var", kVar},
+          }, kIdentifier)
+      .SetPatterns(
+          {
+              // space
+              {"[ \v\r\f\t]", kSpaceSymbol},
+              {"\n", kLFSymbol},
               // multi-char operator
               {"<<", kLeftShift},
               {">>", kRightShift},
@@ -285,18 +287,14 @@ Tokenizer BuildGolikeTokenizer() {
 /*----------------------------------------------------------------------------*/
 // grammar
 
-static void TokenFeeder(void *grammar_data, Token &&token) {
+void TokenFeeder(void *grammar_data, const TokenView &token) {
   auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
   logger.debug("{}(): {}", __func__, to_string(token));
 
-  auto ast_node = golike_data->ast()->CreateNode(move(token));
+  auto ast_node = golike_data->ast()->CreateNode(token);
   golike_data->node_stack().push_back(ast_node);
 }
 
-static void EmptyFunction(void *grammar_data) {
-  // do notghing
-}
-
 static void ParseExpr(void *grammar_data) {
   auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
 
@@ -312,7 +310,7 @@ static void ParseUnaryExpr(void *grammar_data) {
   // UnaryOp PrimaryExpr
 }
 
-static void ParsePrimaryExpr(void *grammar_data) {
+void ParsePrimaryExpr(void *grammar_data) {
   auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
   auto node_stack = golike_data->node_stack();
 
@@ -326,7 +324,7 @@ static void ParsePrimaryExpr(void *grammar_data) {
   }
 }
 
-static void ParsePrimaryExprDot(void *grammar_data) {
+void ParsePrimaryExprDot(void *grammar_data) {
   auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
   auto node_stack = golike_data->node_stack();
 
@@ -338,7 +336,7 @@ static void ParsePrimaryExprDot(void *grammar_data) {
 }
 
 // TODO
-static void ParsePrimaryExprArray(void *grammar_data) {
+void ParsePrimaryExprArray(void *grammar_data) {
   auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
   auto node_stack = golike_data->node_stack();
 
@@ -443,7 +441,12 @@ Grammar BuildGolikeGrammar() {
           kUnaryOp, kBinaryOp, kEndLine,
       });
 
-  builder.SetTokenFeeder(TokenFeeder);
+  builder.SetTokenFeeder(TokenFeeder, "golike_grammar::TokenFeeder");
+  builder.NameSnippet(EmptyFunction, "golike_grammar::EmptyFunction")
+      .NameSnippet(ParsePrimaryExpr, "golike_grammar::ParsePrimaryExpr")
+      .NameSnippet(ParsePrimaryExprDot, "golike_grammar::ParsePrimaryExprDot")
+      .NameSnippet(ParsePrimaryExprArray,
+                   "golike_grammar::ParsePrimaryExprArray");
 
   // End Line & Ignore
   builder.InsertRule(kEndLine, {kLFSymbol}, EmptyFunction);
@@ -680,4 +683,98 @@ std::shared_ptr<GolikeGrammarData> CreateGolikeGrammarData() {
   return std::make_shared<GolikeGrammarData>();
 }
 
+/*----------------------------------------------------------------------------*/
+// incremental parsing
+
+SubtreeHooks CreateGolikeSubtreeHooks() {
+  SubtreeHooks hooks;
+
+  hooks.clear = [](void *grammar_data) {
+    auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
+    golike_data->node_stack().clear();
+  };
+
+  hooks.mark = [](void *grammar_data) {
+    auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
+    return golike_data->node_stack().size();
+  };
+
+  hooks.wrap = [](void *grammar_data, size_t mark, const Symbol &symbol) {
+    auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
+    auto &node_stack = golike_data->node_stack();
+
+    auto subtree = golike_data->ast()->CreateNode(symbol);
+    for (size_t i = mark; i < node_stack.size(); ++i) {
+      subtree->push_child_back(node_stack[i]);
+    }
+    node_stack.resize(mark);
+    node_stack.push_back(subtree);
+    return subtree;
+  };
+
+  hooks.splice = [](void *grammar_data, AstNode *subtree,
+                    const TokenView *token) {
+    auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
+    golike_data->node_stack().push_back(subtree);
+
+    // the snippets do not pop the node stack, so the children of subtree are
+    // the nodes of tokens
+    if (token) {
+      for (auto child : subtree->children()) {
+        child->FetchToken(*token);
+        token += 1;
+      }
+    }
+  };
+
+  return hooks;
+}
+
+std::vector<BinaryOperator> GolikeBinaryOperators() {
+  return {
+      {kMul, 5, false}, {kDiv, 5, false}, {kMod, 5, false},
+      {kLeftShift, 5, false}, {kRightShift, 5, false}, {kBitAnd, 5, false},
+      {kAdd, 4, false}, {kSub, 4, false}, {kBitOr, 4, false},
+      {kBitXor, 4, false},
+      {kEQ, 3, false}, {kNE, 3, false}, {kLT, 3, false}, {kLE, 3, false},
+      {kGT, 3, false}, {kGE, 3, false},
+      {kLogicalAnd, 2, false},
+      {kLogicalOr, 1, false},
+  };
+}
+
+OperatorHooks CreateGolikeOperatorHooks() {
+  OperatorHooks hooks;
+
+  hooks.mark = [](void *grammar_data) {
+    auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
+    return golike_data->node_stack().size();
+  };
+
+  hooks.reduce = [](void *grammar_data, size_t lhs_mark, size_t op_mark) {
+    auto golike_data = static_cast<GolikeGrammarData *>(grammar_data);
+    auto &node_stack = golike_data->node_stack();
+
+    // the snippets of primary expression do not pop the node stack
+    auto operand = [&](size_t first, size_t last) {
+      if (1 == last - first) {
+        return node_stack[first];
+      }
+      auto node = golike_data->ast()->CreateNode(kUnaryExpr);
+      for (size_t i = first; i < last; ++i) {
+        node->push_child_back(node_stack[i]);
+      }
+      return node;
+    };
+
+    auto op_node = node_stack[op_mark];
+    op_node->push_child_back(operand(lhs_mark, op_mark));
+    op_node->push_child_back(operand(op_mark + 1, node_stack.size()));
+    node_stack.resize(lhs_mark);
+    node_stack.push_back(op_node);
+  };
+
+  return hooks;
+}
+
 } // end of namespace golike_grammar
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "grammar.h"
+#include "ll_parser.h"
 #include "tokenizer.h"
 
 namespace golike_grammar {
@@ -203,6 +204,20 @@ Tokenizer BuildGolikeTokenizer();
  */
 Grammar BuildGolikeGrammar();
 
+/**
+ * @brief   the token feeder and snippets of golike grammar, which are named in
+ *          the grammar, so that the generated parser calls them directly
+ */
+void TokenFeeder(void *grammar_data, const TokenView &token);
+
+inline void EmptyFunction(void *grammar_data) {
+  // do nothing
+}
+
+void ParsePrimaryExpr(void *grammar_data);
+void ParsePrimaryExprDot(void *grammar_data);
+void ParsePrimaryExprArray(void *grammar_data);
+
 /**
  * @brief   grammar data passed to LL(1) Parser
  */
@@ -229,4 +244,25 @@ class GolikeGrammarData {
  */
 std::shared_ptr<GolikeGrammarData> CreateGolikeGrammarData();
 
+/**
+ * @brief   create the hooks of incremental parsing, which wrap the nodes of a
+ *          top-level declaration into a subtree on the node stack
+ * @return  hooks on golike grammar data
+ */
+SubtreeHooks CreateGolikeSubtreeHooks();
+
+/**
+ * @brief   the binary operators of kExpr in the precedence of Go, all of them
+ *          are left associative
+ */
+std::vector<BinaryOperator> GolikeBinaryOperators();
+
+/**
+ * @brief   create the hooks of precedence climbing, an operator node takes its
+ *          two operands as children, and an operand of several nodes is
+ *          wrapped into a kUnaryExpr node
+ * @return  hooks on golike grammar data
+ */
+OperatorHooks CreateGolikeOperatorHooks();
+
 } // end of golike_grammar
@@ -6,7 +6,9 @@
 
 #include <climits>
 #include <cassert>
+#include <cstdint>
 
+#include <algorithm>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -18,6 +20,7 @@
 
 typedef std::vector<Symbol> Sequence;
 typedef std::function<void(void *)> SnippetCallback;
+typedef void (*SnippetFunction)(void *);
 
 class ProductionRule {
  public:
@@ -59,7 +62,7 @@ class Grammar {
   typedef std::unordered_multimap<Symbol, size_t> RuleMap;
   typedef std::pair<RuleMap::const_iterator, RuleMap::const_iterator> RuleRange;
   typedef std::unordered_set<Symbol> SymbolTable;
-  typedef std::function<void(void *, Token &&)> TokenFeeder;
+  typedef std::function<void(void *, const TokenView &)> TokenFeeder;
 
   friend class GrammarBuilder;
 
@@ -93,22 +96,97 @@ class Grammar {
     return token_feeder_;
   }
 
+  /**
+   * @return    the qualified name of token feeder, or empty if not named
+   */
+  const std::string &token_feeder_name() const {
+    return token_feeder_name_;
+  }
+
+  /**
+   * @return    the qualified name of the snippet of rule, or empty if the
+   *            snippet is not a named function
+   */
+  const std::string &SnippetName(size_t index) const {
+    assert(index < snippet_names_.size());
+    return snippet_names_[index];
+  }
+
+  /**
+   * @brief     the terminals and non-terminals are numbered densely and
+   *            separately when building the grammar
+   * @return    the index among the symbols of the same type, or SIZE_MAX if
+   *            the symbol is not in grammar
+   */
+  size_t SymbolIndex(const Symbol &symbol) const {
+    size_t offset = static_cast<size_t>(symbol.ID() - min_symbol_id_);
+    return offset < symbol_index_.size() ? symbol_index_[offset] : SIZE_MAX;
+  }
+
+  /**
+   * @brief     the terminals in the order of dense index
+   */
+  const std::vector<Symbol> &terminals() const {
+    return terminals_;
+  }
+
+  /**
+   * @brief     the non-terminals in the order of dense index
+   */
+  const std::vector<Symbol> &nonterminals() const {
+    return nonterminals_;
+  }
+
  private:
   RuleRecord rule_record_;
   RuleMap rule_map_;
   SymbolTable symbol_table_;
   TokenFeeder token_feeder_;
+  std::string token_feeder_name_;
+  std::vector<std::string> snippet_names_;
+
+  /**
+   * @brief     dense index by symbol ID, the IDs are small integers
+   */
+  int min_symbol_id_{0};
+  std::vector<size_t> symbol_index_;
+  std::vector<Symbol> terminals_;
+  std::vector<Symbol> nonterminals_;
 };
 
 class GrammarBuilder {
  public:
+  GrammarBuilder() = default;
+
+  /**
+   * @brief     continue building a grammar, such as a variant with more rules,
+   *            the old rules keep their indices
+   */
+  explicit GrammarBuilder(Grammar &&grammar) : grammar_(std::move(grammar)) {}
+
   GrammarBuilder &SetSymbolTable(Grammar::SymbolTable &&table) {
     grammar_.symbol_table_ = table;
     return *this;
   }
 
-  GrammarBuilder &SetTokenFeeder(Grammar::TokenFeeder token_feeder) {
+  /**
+   * @param name    the qualified name of token feeder, so that a generated
+   *                parser could call it directly
+   */
+  GrammarBuilder &SetTokenFeeder(Grammar::TokenFeeder token_feeder,
+                                 const std::string &name = std::string()) {
     grammar_.token_feeder_ = token_feeder;
+    grammar_.token_feeder_name_ = name;
+    return *this;
+  }
+
+  /**
+   * @brief     name a function used as snippets, the rules of which are
+   *            resolved when building the grammar
+   */
+  GrammarBuilder &NameSnippet(SnippetFunction snippet,
+                              const std::string &name) {
+    snippet_names_.emplace_back(snippet, name);
     return *this;
   }
 
@@ -121,13 +199,73 @@ class GrammarBuilder {
   }
 
   Grammar &&Build() {
+    grammar_.rule_map_.clear();
     for (size_t i = 0; i < grammar_.rule_record_.size(); ++i) {
       grammar_.rule_map_.insert(std::make_pair(grammar_.rule_record_[i].left(),
                                                i));
     }
+    NumberSymbols();
+    ResolveSnippetNames();
     return std::move(grammar_);
   }
 
  private:
+  /**
+   * @brief     the snippets wrapping a named function get its name, the names
+   *            resolved by last building are kept
+   */
+  void ResolveSnippetNames() {
+    grammar_.snippet_names_.resize(grammar_.rule_record_.size());
+    for (size_t i = 0; i < grammar_.rule_record_.size(); ++i) {
+      if (!grammar_.snippet_names_[i].empty()) {
+        continue;
+      }
+      auto function =
+          grammar_.rule_record_[i].snippet().target<SnippetFunction>();
+      if (!function) {
+        continue;
+      }
+      for (auto &named : snippet_names_) {
+        if (named.first == *function) {
+          grammar_.snippet_names_[i] = named.second;
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief     number the symbols of table and rules in the order of ID
+   */
+  void NumberSymbols() {
+    std::vector<Symbol> symbols(grammar_.symbol_table_.begin(),
+                                grammar_.symbol_table_.end());
+    for (auto &rule : grammar_.rule_record_) {
+      symbols.push_back(rule.left());
+      symbols.insert(symbols.end(), rule.right().begin(), rule.right().end());
+    }
+    std::sort(symbols.begin(), symbols.end());
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+
+    grammar_.terminals_.clear();
+    grammar_.nonterminals_.clear();
+    grammar_.symbol_index_.clear();
+    if (symbols.empty()) {
+      return;
+    }
+
+    grammar_.min_symbol_id_ = symbols.front().ID();
+    grammar_.symbol_index_.assign(
+        symbols.back().ID() - symbols.front().ID() + 1, SIZE_MAX);
+    for (auto &symbol : symbols) {
+      auto &same_type = symbol.IsTerminal() ? grammar_.terminals_
+                                            : grammar_.nonterminals_;
+      grammar_.symbol_index_[symbol.ID() - grammar_.min_symbol_id_] =
+          same_type.size();
+      same_type.push_back(symbol);
+    }
+  }
+
   Grammar grammar_;
+  std::vector<std::pair<SnippetFunction, std::string>> snippet_names_;
 };
@@ -0,0 +1,81 @@
+//
+// Created by coder on 16-10-14.
+//
+
+#include "keyword_table.h"
+#include "simplelogger.h"
+
+#include <unordered_set>
+
+using std::vector;
+using std::string;
+
+extern simple_logger::BaseLogger logger;
+
+constexpr int KeywordTable::kEmptySlot;
+
+namespace {
+
+/**
+ * @brief   the seeds tried for each number of slots
+ */
+constexpr uint32_t kMaxSeedTries = 1 << 12;
+
+} // end of anonymous namespace
+
+bool KeywordTable::Place(uint32_t seed, size_t slot_num) {
+  slots_.assign(slot_num, kEmptySlot);
+  for (size_t i = 0; i < keywords_.size(); ++i) {
+    auto &text = keywords_[i].first;
+    auto &slot = slots_[Hash(text.data(), text.size(), seed) & (slot_num - 1)];
+    if (kEmptySlot != slot) {
+      return false;
+    }
+    slot = static_cast<int>(i);
+  }
+  seed_ = seed;
+  return true;
+}
+
+bool KeywordTable::Build(vector<Keyword> keywords) {
+  std::unordered_set<string> texts;
+  for (auto &keyword : keywords) {
+    if (!texts.insert(keyword.first).second) {
+      logger.error("{}(): duplicated keyword {}", __func__, keyword.first);
+      return false;
+    }
+  }
+  if (keywords.empty()) {
+    logger.error("{}(): no keyword", __func__);
+    return false;
+  }
+  keywords_ = std::move(keywords);
+
+  // a sparser table makes a perfect seed easier to find
+  size_t slot_num = 1;
+  while (slot_num < keywords_.size() * 2) {
+    slot_num <<= 1;
+  }
+
+  while (true) {
+    for (uint32_t seed = 0; seed < kMaxSeedTries; ++seed) {
+      if (Place(seed, slot_num)) {
+        return true;
+      }
+    }
+    slot_num <<= 1;
+  }
+}
+
+bool KeywordTable::Build(vector<Keyword> keywords, uint32_t seed,
+                         size_t slot_num) {
+  keywords_ = std::move(keywords);
+  if (keywords_.empty() || 0 == slot_num || 0 != (slot_num & (slot_num - 1))
+      || !Place(seed, slot_num)) {
+    logger.error("{}(): the seed {} is not perfect", __func__, seed);
+    keywords_.clear();
+    slots_.clear();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,118 @@
+//
+// Created by coder on 16-10-14.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "symbol.h"
+
+typedef std::pair<std::string, Symbol> Keyword;
+
+/**
+ * @brief   Classify the words into keywords by a perfect hash, instead of
+ *          matching the keywords by DFA.
+ *
+ * @details Each keyword hashes to its own slot with the seed, so a lookup is
+ *          one hash and one comparison. The hash is constexpr, so that the
+ *          generated sources could compute the slots at compile time.
+ */
+class KeywordTable {
+ public:
+  constexpr static int kEmptySlot{-1};
+
+  /**
+   * @brief     FNV-1a mixed with the seed and the size, the bits are mixed at
+   *            last so that the low bits depend on the whole seed
+   */
+  constexpr static uint32_t Hash(const char *p, size_t size, uint32_t seed) {
+    return Finalize(HashRecur(p, size, (2166136261u ^ seed) * 16777619u
+        ^ static_cast<uint32_t>(size)));
+  }
+
+  bool empty() const {
+    return keywords_.empty();
+  }
+
+  const std::vector<Keyword> &keywords() const {
+    return keywords_;
+  }
+
+  uint32_t seed() const {
+    return seed_;
+  }
+
+  /**
+   * @return    the number of slots, a power of 2
+   */
+  size_t slot_num() const {
+    return slots_.size();
+  }
+
+  /**
+   * @brief     search a seed without collision
+   * @return    false if the keywords are duplicated or empty
+   */
+  bool Build(std::vector<Keyword> keywords);
+
+  /**
+   * @brief     use the seed found before, such as a saved one
+   * @return    false if the keywords collide with the seed
+   */
+  bool Build(std::vector<Keyword> keywords, uint32_t seed, size_t slot_num);
+
+  /**
+   * @return    the symbol of keyword, nullptr if the text is not a keyword
+   */
+  const Symbol *Find(const char *p, size_t size) const {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+
+    int index = slots_[Hash(p, size, seed_) & (slots_.size() - 1)];
+    if (kEmptySlot == index) {
+      return nullptr;
+    }
+
+    auto &keyword = keywords_[index];
+    if (keyword.first.size() != size
+        || 0 != memcmp(keyword.first.data(), p, size)) {
+      return nullptr;
+    }
+    return &keyword.second;
+  }
+
+ private:
+  constexpr static uint32_t ShiftXor(uint32_t hash, int shift) {
+    return hash ^ (hash >> shift);
+  }
+
+  /**
+   * @brief     the finalizer of MurmurHash3
+   */
+  constexpr static uint32_t Finalize(uint32_t hash) {
+    return ShiftXor(ShiftXor(ShiftXor(hash, 16) * 0x85ebca6bu, 13)
+                        * 0xc2b2ae35u, 16);
+  }
+
+  constexpr static uint32_t HashRecur(const char *p, size_t size,
+                                      uint32_t hash) {
+    return 0 == size ? hash : HashRecur(
+        p + 1, size - 1, (hash ^ static_cast<uint8_t>(*p)) * 16777619u);
+  }
+
+  /**
+   * @return    whether all the keywords hash to different slots
+   */
+  bool Place(uint32_t seed, size_t slot_num);
+
+ private:
+  std::vector<Keyword> keywords_;
+  std::vector<int> slots_;
+  uint32_t seed_{0};
+};
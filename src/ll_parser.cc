@@ -15,295 +15,593 @@ using std::move;
 
 extern simple_logger::BaseLogger logger;
 
-SymbolAuxSet CalcFirst(const Grammar &grammar) {
-  SymbolAuxSet firsts;
+constexpr LLTable::RuleIndex LLTable::kErrorRule;
+
+void FirstFollow::Reset(const Grammar &grammar) {
+  terminals_ = grammar.terminals();
+  nonterminals_ = grammar.nonterminals();
+  epsilon_ = grammar.SymbolIndex(kEpsilonSymbol);
+  rule_num_ = 0;
+
+  firsts_.assign(nonterminals_.size(), TerminalSet(terminals_.size()));
+  follows_.assign(nonterminals_.size(), TerminalSet(terminals_.size()));
+  rules_of_left_.assign(nonterminals_.size(), {});
+  rules_of_right_.assign(nonterminals_.size(), {});
+
+  size_t start = grammar.SymbolIndex(kStartSymbol);
+  size_t eof = grammar.SymbolIndex(kEofSymbol);
+  if (start < nonterminals_.size() && eof < terminals_.size()) {
+    follows_[start].Insert(eof);
+  }
+}
 
-  for (auto &symbol : grammar.symbol_table()) {
-    if (symbol.IsTerminal()) {
-      firsts[symbol] = {symbol};
-    } else {
-      firsts[symbol] = {};
+bool FirstFollow::MergeFirst(const Grammar &grammar, const Symbol &symbol,
+                             TerminalSet &set) const {
+  size_t index = grammar.SymbolIndex(symbol);
+  if (symbol.IsTerminal()) {
+    if (index == epsilon_) {
+      return true;
     }
+    set.Insert(index);
+    return false;
   }
+  set.Merge(firsts_[index], epsilon_);
+  return firsts_[index].Test(epsilon_);
+}
 
-  bool is_change = false;
-  do {
-    is_change = false;
-    for (auto &rule : grammar.AllRules()) {
-      // fetch a rule: A->B1B2...Bk
-      auto &left = rule.left();
-      auto &right = rule.right();
-
-      // init loop: curr_set <- First(B1) - epsilon
-      auto iter = right.begin();
-      auto curr_set = firsts[*iter];
-      curr_set.erase(kEpsilonSymbol);
-
-      while (iter != right.end()
-          && firsts[*iter].end() != firsts[*iter].find(kEpsilonSymbol)) {
-        // curr_set <- curr_set & (First(Bk+1) - epsilon)
-        auto inserted_set = firsts[*iter++];
-        inserted_set.erase(kEpsilonSymbol);
-        curr_set.insert(inserted_set.begin(), inserted_set.end());
-      }
+void FirstFollow::UpdateFirst(const Grammar &grammar, vector<size_t> &worklist,
+                              vector<bool> &is_first_changed) {
+  vector<bool> is_pending(grammar.RuleNumber(), false);
+  for (size_t rule_index : worklist) {
+    is_pending[rule_index] = true;
+  }
 
-      // if B1B2...Bk could be epsilon, then A could be epsilon
-      auto last_set = firsts[right.back()];
-      if (iter == right.end()
-          && last_set.end() != last_set.find(kEpsilonSymbol)) {
-        curr_set.insert(kEpsilonSymbol);
+  TerminalSet curr_set(terminals_.size());
+  while (!worklist.empty()) {
+    size_t rule_index = worklist.back();
+    worklist.pop_back();
+    is_pending[rule_index] = false;
+    ++visited_num_;
+
+    // fetch a rule: A->B1B2...Bk, and First(A) <- First(B1...Bi), where Bi is
+    // the first one not nullable
+    auto &rule = grammar.GetRule(rule_index);
+    curr_set = TerminalSet(terminals_.size());
+    bool is_nullable = true;
+    for (auto &symbol : rule.right()) {
+      if (!MergeFirst(grammar, symbol, curr_set)) {
+        is_nullable = false;
+        break;
       }
+    }
+    if (is_nullable && epsilon_ != SIZE_MAX) {
+      curr_set.Insert(epsilon_);
+    }
 
-      size_t old_size = firsts[left].size();
-      firsts[left].insert(curr_set.begin(), curr_set.end());
-
-      // check whether changed
-      if (!is_change && old_size < firsts[left].size()) {
-        is_change = true;
+    size_t left = grammar.SymbolIndex(rule.left());
+    if (!firsts_[left].Merge(curr_set)) {
+      continue;
+    }
+    is_first_changed[left] = true;
+    for (size_t next : rules_of_right_[left]) {
+      if (!is_pending[next]) {
+        is_pending[next] = true;
+        worklist.push_back(next);
       }
     }
-
-  } while (is_change);
-
-  return firsts;
+  }
 }
 
-SymbolAuxSet CalcFollow(const Grammar &grammar, const SymbolAuxSet &firsts) {
-  SymbolAuxSet follows;
-  for (auto &symbol : grammar.symbol_table()) {
-    follows[symbol] = {};
+void FirstFollow::UpdateFollow(const Grammar &grammar,
+                               vector<size_t> &worklist) {
+  vector<bool> is_pending(grammar.RuleNumber(), false);
+  for (size_t rule_index : worklist) {
+    is_pending[rule_index] = true;
   }
 
-  follows[kStartSymbol].insert(kEofSymbol);
-
-  bool is_change;
-  do {
-    is_change = false;
-    for (auto &rule : grammar.AllRules()) {
-      // fetch a rule: A->B1B2...Bk
-      auto &left = rule.left();
-      auto &right = rule.right();
-
-      // init loop: curr_set <- Follow(A)
-      set<Symbol> curr_set = follows[left];
-
-      for (auto iter = right.rbegin(); iter != right.rend(); ++iter) {
-        auto &right_part = *iter;
-        auto &right_part_first = firsts.find(right_part)->second;
-
-        if (!right_part.IsTerminal()) {
-          auto &right_part_follow = follows[right_part];
-
-          // Follow(Bi) <- Follow(Bi) & curr_set
-          size_t old_size = right_part_follow.size();
-          right_part_follow.insert(curr_set.begin(), curr_set.end());
-
-          // check wether change
-          if (!is_change && old_size < right_part_follow.size()) {
-            is_change = true;
+  TerminalSet curr_set(terminals_.size());
+  while (!worklist.empty()) {
+    size_t rule_index = worklist.back();
+    worklist.pop_back();
+    is_pending[rule_index] = false;
+    ++visited_num_;
+
+    // fetch a rule: A->B1B2...Bk, and Follow(Bi) <- First(Bi+1...Bk), with
+    // Follow(A) if Bi+1...Bk is nullable
+    auto &rule = grammar.GetRule(rule_index);
+    curr_set = follows_[grammar.SymbolIndex(rule.left())];
+
+    auto &right = rule.right();
+    for (auto iter = right.rbegin(); iter != right.rend(); ++iter) {
+      if (iter->IsNonTerminal()) {
+        size_t nonterminal = grammar.SymbolIndex(*iter);
+        if (follows_[nonterminal].Merge(curr_set)) {
+          for (size_t next : rules_of_left_[nonterminal]) {
+            if (!is_pending[next]) {
+              is_pending[next] = true;
+              worklist.push_back(next);
+            }
           }
-
-          if (right_part_first.end() != right_part_first.find(kEpsilonSymbol)) {
-            // curr_set <- curr_set & (First(Bi) - epsilon)
-            auto inserted = right_part_first;
-            inserted.erase(kEpsilonSymbol);
-            curr_set.insert(inserted.begin(), inserted.end());
-          } else {
-            // curr_set <- First(Bi)
-            curr_set = right_part_first;
-          }
-        } else {
-          // curr_set <- First(Bi)
-          curr_set = right_part_first;
         }
       }
+
+      TerminalSet symbol_first(terminals_.size());
+      if (MergeFirst(grammar, *iter, symbol_first)) {
+        curr_set.Merge(symbol_first);
+      } else {
+        curr_set = std::move(symbol_first);
+      }
     }
+  }
+}
 
-  } while (is_change);
+void FirstFollow::Update(const Grammar &grammar) {
+  visited_num_ = 0;
+  if (grammar.terminals() != terminals_
+      || grammar.nonterminals() != nonterminals_
+      || grammar.RuleNumber() < rule_num_) {
+    Reset(grammar);
+  }
 
-  return follows;
-}
+  // the new rules, and the old rules depending on them
+  size_t old_rule_num = rule_num_;
+  vector<size_t> worklist;
+  for (size_t i = old_rule_num; i < grammar.RuleNumber(); ++i) {
+    auto &rule = grammar.GetRule(i);
+    rules_of_left_[grammar.SymbolIndex(rule.left())].push_back(i);
+    for (auto &symbol : rule.right()) {
+      if (symbol.IsNonTerminal()) {
+        auto &rules = rules_of_right_[grammar.SymbolIndex(symbol)];
+        if (rules.empty() || rules.back() != i) {
+          rules.push_back(i);
+        }
+      }
+    }
+    worklist.push_back(i);
+  }
+  rule_num_ = grammar.RuleNumber();
 
-ExtendFirst CalcExtendFirst(const Grammar &grammar,
-                            const SymbolAuxSet &firsts,
-                            const SymbolAuxSet &follows) {
+  vector<bool> is_first_changed(nonterminals_.size(), false);
+  UpdateFirst(grammar, worklist, is_first_changed);
 
-  logger.log("First:");
-  for (auto &p : firsts) {
-    if (p.second.empty()) continue;
-    logger.log("{}'s first set, size {}: ", p.first, p.second.size());
-    for (auto &s : p.second) {
-      std::cout << s << " ";
+  // Follow depends on the changed First of the right parts
+  vector<bool> is_pending(rule_num_, false);
+  std::fill(is_pending.begin() + old_rule_num, is_pending.end(), true);
+  for (size_t i = 0; i < nonterminals_.size(); ++i) {
+    if (!is_first_changed[i]) {
+      continue;
     }
-    std::cout << std::endl;
-  }
-  logger.log("Follow:");
-  for (auto &p : follows) {
-    if (p.second.empty()) continue;
-    logger.log("{}'s follow set:", p.first);
-    for (auto &s : p.second) {
-      std::cout << s << " ";
+    for (size_t rule_index : rules_of_right_[i]) {
+      is_pending[rule_index] = true;
     }
-    std::cout << std::endl;
   }
+  for (size_t i = 0; i < rule_num_; ++i) {
+    if (is_pending[i]) {
+      worklist.push_back(i);
+    }
+  }
+  UpdateFollow(grammar, worklist);
+}
 
-  ExtendFirst extend_first(grammar.RuleNumber());
-
-  for (size_t i = 0; i < extend_first.size(); ++i) {
-    // fetch a rule: A->B1B2...Bk
-    auto &left = grammar.GetRule(i).left();
-    auto &right = grammar.GetRule(i).right();
+TerminalSet FirstFollow::RuleFirst(const Grammar &grammar,
+                                   size_t rule_index) const {
+  // First+(A->B1B2...Bk) is First(B1) & First(B2) & ... First(Bi), where Bi is
+  // the first one not nullable, and the nullable ones keep their Epsilon
+  auto &rule = grammar.GetRule(rule_index);
+  TerminalSet result(terminals_.size());
+  for (auto &symbol : rule.right()) {
+    if (!MergeFirst(grammar, symbol, result)) {
+      return result;
+    }
+    result.Insert(epsilon_);
+  }
 
-    // fill the First+(i) with (First(B1) & First(B2) & ... First(Bi)),
-    // where Bi is the first one which epsilon does not belong to First(Bi)
-    auto iter = right.begin();
-    while (iter != right.end()) {
-      auto &curr_first = firsts.find(*iter)->second;
-      extend_first[i].insert(curr_first.begin(), curr_first.end());
+  // if B1B2...Bk could be epsilon, then using Follow(A)
+  result.Merge(follows_[grammar.SymbolIndex(rule.left())]);
+  return result;
+}
 
-      if (curr_first.end() == curr_first.find(kEpsilonSymbol)) {
-        break;
-      }
-      ++iter;
+bool BuildLLTable(const Grammar &grammar,
+                  const FirstFollow &first_follow,
+                  LLTable &ll_table,
+                  LLTableReport *report) {
+  if (report) {
+    *report = LLTableReport();
+    report->firsts.reserve(grammar.nonterminals().size());
+    report->follows.reserve(grammar.nonterminals().size());
+    for (size_t i = 0; i < grammar.nonterminals().size(); ++i) {
+      report->firsts.push_back(first_follow.first(i));
+      report->follows.push_back(first_follow.follow(i));
     }
+    report->visited_num = first_follow.visited_num();
+  }
 
-    // if B1B2...Bk could be epsilon, then using Follow(A)
-    if (iter == right.end()) {
-      auto &left_follow = follows.find(left)->second;
-      extend_first[i].insert(left_follow.begin(), left_follow.end());
+  if (grammar.RuleNumber() >= LLTable::kErrorRule) {
+    if (report) {
+      report->is_too_many_rules = true;
     }
+    return false;
   }
 
-  return extend_first;
-}
+  bool is_conflict = false;
+  ll_table.Reset(grammar.nonterminals().size(), grammar.terminals().size());
+  for (size_t i = 0; i < grammar.RuleNumber() && (report || !is_conflict);
+       ++i) {
+    size_t left = grammar.SymbolIndex(grammar.GetRule(i).left());
+    auto rule_first = first_follow.RuleFirst(grammar, i);
+
+    rule_first.ForEach([&](size_t column) {
+      auto curr_rule = ll_table.Get(left, column);
+      if (LLTable::kErrorRule == curr_rule) {
+        ll_table.Set(left, column, static_cast<LLTable::RuleIndex>(i));
+        return;
+      }
+      is_conflict = true;
+      if (report) {
+        report->conflicts.push_back({left, column, curr_rule, i});
+      }
+    });
 
-bool BuildLLTable(const Grammar &grammar,
-                  const ExtendFirst &extend_firsts,
-                  LLTable &ll_table) {
-  for (size_t i = 0; i < extend_firsts.size(); ++i) {
-    std::cout << "[Extend of Rule " << i <<  ']' << std::endl;
-    for (auto &terminal : extend_firsts[i]) {
-      std::cout << terminal << " ";
+    if (report) {
+      report->rule_firsts.push_back(std::move(rule_first));
     }
-    std::cout << std::endl;
-  }
-
-  for (size_t i = 0; i < extend_firsts.size(); ++i) {
-    auto &left = grammar.GetRule(i).left();
-    auto &left_entry = ll_table[left];
-    for (auto &terminal : extend_firsts[i]) {
-      if (left_entry.end() != left_entry.find(terminal)) {
-        logger.error("LL(1) conflict on left {} terminal {},\n"
-                         "curr rule: {}\n new rule: {}",
-                     left, terminal,
-                     grammar.GetRule(left_entry.find(terminal)->second),
-                     grammar.GetRule(i));
-        return false;
+  }
+
+  if (report) {
+    for (size_t i = 0; i < ll_table.nonterminal_num(); ++i) {
+      for (size_t k = 0; k < ll_table.terminal_num(); ++k) {
+        report->entry_num += LLTable::kErrorRule != ll_table.Get(i, k);
       }
-      left_entry.insert({terminal, i});
     }
   }
-  return true;
+  return !is_conflict;
+}
+
+bool BuildLLTable(const Grammar &grammar,
+                  LLTable &ll_table,
+                  LLTableReport *report) {
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
+  return BuildLLTable(grammar, first_follow, ll_table, report);
 }
 
-bool BuildLLTable(const Grammar &grammar, LLTable &ll_table) {
-  auto firsts = CalcFirst(grammar);
-  auto follows = CalcFollow(grammar, firsts);
-  auto extend_firsts = CalcExtendFirst(grammar, firsts, follows);
-  return BuildLLTable(grammar, extend_firsts, ll_table);
+void PrintLLTableReport(std::ostream &os,
+                        const Grammar &grammar,
+                        const LLTableReport &report) {
+  auto print_set = [&](const TerminalSet &set) {
+    set.ForEach([&](size_t terminal) {
+      os << ' ' << grammar.terminals()[terminal];
+    });
+    os << '\n';
+  };
+
+  os << "First:\n";
+  for (size_t i = 0; i < report.firsts.size(); ++i) {
+    os << "  " << grammar.nonterminals()[i] << ':';
+    print_set(report.firsts[i]);
+  }
+  os << "Follow:\n";
+  for (size_t i = 0; i < report.follows.size(); ++i) {
+    os << "  " << grammar.nonterminals()[i] << ':';
+    print_set(report.follows[i]);
+  }
+  os << "First+:\n";
+  for (size_t i = 0; i < report.rule_firsts.size(); ++i) {
+    os << "  [Rule " << i << "] " << grammar.GetRule(i) << " :";
+    print_set(report.rule_firsts[i]);
+  }
+
+  if (report.is_too_many_rules) {
+    os << "too many rules " << grammar.RuleNumber() << '\n';
+  }
+  for (auto &conflict : report.conflicts) {
+    os << "LL(1) conflict on left "
+       << grammar.nonterminals()[conflict.nonterminal] << " terminal "
+       << grammar.terminals()[conflict.terminal] << ",\n"
+       << "  curr rule: " << grammar.GetRule(conflict.curr_rule) << '\n'
+       << "   new rule: " << grammar.GetRule(conflict.new_rule) << '\n';
+  }
+  os << grammar.nonterminals().size() << " non-terminals, "
+     << grammar.terminals().size() << " terminals, "
+     << report.entry_num << " entries, "
+     << report.conflicts.size() << " conflicts, "
+     << report.visited_num << " rules visited\n";
 }
 
-bool LLParser::ProductNonTerminal(StackState &top_state, const Token &token) {
+bool LLParser::ProductNonTerminal(const TokenView &token) {
+  auto &top_symbol = production_stack_.back().symbol;
 
-  auto jump_list_iter = ll_table_.find(top_state.symbol);
-  if (ll_table_.end() == jump_list_iter) {
+  size_t nonterminal = grammar_.SymbolIndex(top_symbol);
+  if (nonterminal >= ll_table_.nonterminal_num()) {
     logger.error("wrong LL(1) Table: top symbol {}, no such symbol in table",
-                 top_state.symbol);
+                 top_symbol);
     return false;
   }
 
-  auto rule_index_iter = jump_list_iter->second.find(token.symbol);
-  if (jump_list_iter->second.end() == rule_index_iter) {
+  size_t terminal = grammar_.SymbolIndex(token.symbol);
+  if (terminal >= ll_table_.terminal_num() || !token.symbol.IsTerminal()
+      || LLTable::kErrorRule == ll_table_.Get(nonterminal, terminal)) {
     logger.error(
         "wrong LL(1) Table: top symbol {}, no such {} in jump list",
-        top_state.symbol,
+        top_symbol,
         to_string(token));
     return false;
   }
 
-  size_t rule_index = rule_index_iter->second;
+  size_t rule_index = ll_table_.Get(nonterminal, terminal);
   auto &right = grammar_.GetRule(rule_index).right();
 
+  // the top state is moved by pushing
+  production_stack_.back().rule_index = rule_index;
+  production_stack_.back().is_handled = true;
+
   for (auto iter = right.rbegin(); iter != right.rend(); ++iter) {
-    production_stack_.push({*iter, SIZE_MAX, false});
+    production_stack_.push_back({*iter, SIZE_MAX, false});
   }
 
-  top_state.rule_index = rule_index;
-  top_state.is_handled = true;
-
   return true;
 }
 
+namespace {
+
+/**
+ * @brief   the tokens in a vector, the iterator of caller is advanced
+ */
+class TokenRange {
+ public:
+  TokenRange(vector<TokenView>::iterator &token_iter,
+             vector<TokenView>::iterator token_end)
+      : token_iter_(token_iter), token_end_(token_end) {}
+
+  bool IsEnd() const {
+    return token_iter_ == token_end_;
+  }
+
+  const TokenView &Peek() const {
+    return *token_iter_;
+  }
+
+  void Advance() {
+    ++token_iter_;
+  }
+
+ private:
+  vector<TokenView>::iterator &token_iter_;
+  vector<TokenView>::iterator token_end_;
+};
+
+/**
+ * @brief   the tokens pulled from a cursor with one token of lookahead, a EOF
+ *          token follows the last one, or the one of lexing error
+ */
+class CursorTokens {
+ public:
+  explicit CursorTokens(TokenizerCursor &cursor)
+      : cursor_(cursor), lookahead_(TextSlice(), kErrorSymbol) {
+    Advance();
+  }
+
+  bool IsEnd() const {
+    return is_end_;
+  }
+
+  const TokenView &Peek() const {
+    return lookahead_;
+  }
+
+  void Advance() {
+    if (is_eof_) {
+      is_end_ = true;
+    } else if (!cursor_.Next(lookahead_)) {
+      lookahead_ = kEofToken.view();
+      is_eof_ = true;
+    }
+  }
+
+ private:
+  TokenizerCursor &cursor_;
+  TokenView lookahead_;
+  bool is_eof_{false};
+  bool is_end_{false};
+};
+
+} // end of anonymous namespace
+
+template <typename TokenSource>
 bool LLParser::ProductTerminal(void *grammar_data,
                                StackState &top_state,
-                               vector<Token>::iterator &token_iter) {
+                               TokenSource &tokens) {
   if (top_state.symbol == kEpsilonSymbol) {
     // skip epsilon
     return true;
 
-  } else if (top_state.symbol == token_iter->symbol) {
+  } else if (top_state.symbol == tokens.Peek().symbol) {
     // feed a token
-    grammar_.token_feeder()(grammar_data, std::move(*token_iter));
-    ++token_iter;
+    grammar_.token_feeder()(grammar_data, tokens.Peek());
+    tokens.Advance();
     return true;
 
   } else {
     // mismatch
     logger.error("terminal mismatch: top state {}, candidate {}",
-                 top_state.symbol, token_iter->symbol);
+                 top_state.symbol, tokens.Peek().symbol);
     return false;
   }
 }
 
-bool LLParser::Parse(void *grammar_data, vector<Token> &tokens) {
+bool LLParser::Parse(void *grammar_data, const vector<Token> &tokens) {
+  vector<TokenView> token_views;
+  token_views.reserve(tokens.size() + 1);
+  for (auto &token : tokens) {
+    token_views.push_back(token.view());
+  }
+  return Parse(grammar_data, token_views);
+}
 
-  tokens.push_back(kEofToken);
+bool LLParser::SetOperatorTable(const Symbol &expr, const Symbol &operand,
+                                const vector<BinaryOperator> &operators,
+                                OperatorHooks hooks) {
+  size_t expr_index = grammar_.SymbolIndex(expr);
+  if (!expr.IsNonTerminal() || expr_index >= ll_table_.nonterminal_num()
+      || !operand.IsNonTerminal()
+      || grammar_.SymbolIndex(operand) >= ll_table_.nonterminal_num()) {
+    logger.error("{}(): {} or {} is not a non-terminal in table", __func__,
+                 expr, operand);
+    return false;
+  }
 
-  bool result = true;
-  auto token_iter = tokens.begin();
+  OperatorTable table{operand,
+                      vector<int>(ll_table_.terminal_num(), 0),
+                      vector<bool>(ll_table_.terminal_num(), false),
+                      std::move(hooks)};
+  for (auto &op : operators) {
+    size_t terminal = grammar_.SymbolIndex(op.symbol);
+    if (!op.symbol.IsTerminal() || terminal >= ll_table_.terminal_num()
+        || op.precedence <= 0) {
+      logger.error("{}(): {} is not a terminal in table, or precedence {}",
+                   __func__, op.symbol, op.precedence);
+      return false;
+    }
+    table.precedences[terminal] = op.precedence;
+    table.is_right_assoc[terminal] = op.is_right_assoc;
+  }
+
+  if (operator_table_index_.empty()) {
+    operator_table_index_.resize(ll_table_.nonterminal_num(), SIZE_MAX);
+  }
+  size_t &index = operator_table_index_[expr_index];
+  if (SIZE_MAX == index) {
+    index = operator_tables_.size();
+    operator_tables_.push_back(std::move(table));
+  } else {
+    operator_tables_[index] = std::move(table);
+  }
+  return true;
+}
+
+template <typename TokenSource>
+bool LLParser::ParseOperators(void *grammar_data,
+                              TokenSource &tokens,
+                              const OperatorTable &table) {
+  // the stacks may hold the operators and operands of outer expressions
+  size_t operator_base = operator_stack_.size();
+  size_t operand_base = operand_marks_.size();
+
+  auto parse_operand = [&]() {
+    operand_marks_.push_back(table.hooks.mark(grammar_data));
+    size_t depth = production_stack_.size();
+    production_stack_.push_back({table.operand, SIZE_MAX, false});
+    return Run(grammar_data, tokens, kErrorSymbol, depth);
+  };
+
+  auto reduce = [&]() {
+    size_t op_mark = operator_stack_.back().mark;
+    operator_stack_.pop_back();
+    operand_marks_.pop_back();
+    table.hooks.reduce(grammar_data, operand_marks_.back(), op_mark);
+  };
+
+  if (!parse_operand()) {
+    return false;
+  }
+  while (!tokens.IsEnd()) {
+    size_t terminal = grammar_.SymbolIndex(tokens.Peek().symbol);
+    if (terminal >= table.precedences.size()
+        || 0 == table.precedences[terminal]) {
+      break;
+    }
+
+    // the operators binding tighter are reduced before this one
+    int precedence = table.precedences[terminal];
+    bool is_right_assoc = table.is_right_assoc[terminal];
+    while (operator_stack_.size() > operator_base
+        && (operator_stack_.back().precedence > precedence
+            || (operator_stack_.back().precedence == precedence
+                && !is_right_assoc))) {
+      reduce();
+    }
+
+    operator_stack_.push_back({precedence, table.hooks.mark(grammar_data)});
+    grammar_.token_feeder()(grammar_data, tokens.Peek());
+    tokens.Advance();
+
+    if (!parse_operand()) {
+      return false;
+    }
+  }
 
-  while (!production_stack_.empty()) {
-    production_stack_.pop();
+  while (operator_stack_.size() > operator_base) {
+    reduce();
   }
-  production_stack_.push({kStartSymbol, SIZE_MAX, false});
+  operand_marks_.resize(operand_base);
+  return true;
+}
 
-  while (!production_stack_.empty() && token_iter != tokens.end()) {
-    StackState &top_state = production_stack_.top();
+template <typename TokenSource>
+bool LLParser::Run(void *grammar_data,
+                   TokenSource &tokens,
+                   const Symbol &stop_symbol,
+                   size_t base_depth) {
+  while (production_stack_.size() > base_depth && !tokens.IsEnd()) {
+    StackState &top_state = production_stack_.back();
 
     if (top_state.is_handled) {
       //  pop
       grammar_.GetRule(top_state.rule_index).snippet()(grammar_data);
-      production_stack_.pop();
+      production_stack_.pop_back();
 
     } else {
       // product
       if (top_state.symbol.IsNonTerminal()) {
-        if (!ProductNonTerminal(top_state, *token_iter)) {
-          result = false;
-          break;
+        if (top_state.symbol == stop_symbol) {
+          return true;
+        }
+        size_t nonterminal = grammar_.SymbolIndex(top_state.symbol);
+        if (nonterminal < operator_table_index_.size()) {
+          size_t index = operator_table_index_[nonterminal];
+          if (SIZE_MAX != index) {
+            production_stack_.pop_back();
+            if (!ParseOperators(grammar_data, tokens,
+                                operator_tables_[index])) {
+              return false;
+            }
+            continue;
+          }
+        }
+        if (!ProductNonTerminal(tokens.Peek())) {
+          return false;
         }
 
       } else {
-        if (!ProductTerminal(grammar_data, top_state, token_iter)) {
-          result = false;
-          break;
+        if (!ProductTerminal(grammar_data, top_state, tokens)) {
+          return false;
         }
-        production_stack_.pop();
+        production_stack_.pop_back();
       }
     }
   }
+  return true;
+}
+
+bool LLParser::Run(void *grammar_data,
+                   vector<TokenView>::iterator &token_iter,
+                   const vector<TokenView>::iterator &token_end,
+                   const Symbol &stop_symbol) {
+  TokenRange tokens(token_iter, token_end);
+  return Run(grammar_data, tokens, stop_symbol);
+}
+
+template <typename TokenSource>
+bool LLParser::ParseTokens(void *grammar_data, TokenSource &tokens) {
+  production_stack_.clear();
+  production_stack_.push_back({kStartSymbol, SIZE_MAX, false});
+  operator_stack_.clear();
+  operand_marks_.clear();
 
-  result = result && token_iter->symbol == kEofSymbol;
+  // the error symbol is never on the stack
+  bool result = Run(grammar_data, tokens, kErrorSymbol);
+
+  result = result && tokens.Peek().symbol == kEofSymbol;
 
   if (result) {
     logger.debug("parsing finished, accept");
@@ -313,3 +611,239 @@ bool LLParser::Parse(void *grammar_data, vector<Token> &tokens) {
 
   return result;
 }
+
+bool LLParser::Parse(void *grammar_data, vector<TokenView> &tokens) {
+
+  tokens.push_back(kEofToken.view());
+
+  auto token_iter = tokens.begin();
+  TokenRange token_range(token_iter, tokens.end());
+  return ParseTokens(grammar_data, token_range);
+}
+
+bool LLParser::Parse(void *grammar_data, TokenizerCursor &cursor) {
+  CursorTokens tokens(cursor);
+  return ParseTokens(grammar_data, tokens) && !cursor.IsError();
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool IncrementalLLParser::Parse(void *grammar_data,
+                                vector<TokenView> &tokens) {
+  tokens.push_back(kEofToken.view());
+
+  hooks_.clear(grammar_data);
+  items_.clear();
+  subtrees_.clear();
+  reused_num_ = 0;
+  is_parsed_ = false;
+
+  auto &production_stack = parser_.production_stack_;
+  production_stack.clear();
+  production_stack.push_back({kStartSymbol, SIZE_MAX, false});
+
+  // the part before the first item
+  auto token_iter = tokens.begin();
+  if (!parser_.Run(grammar_data, token_iter, tokens.end(), item_symbol_)) {
+    logger.error("parsing finished, error");
+    return false;
+  }
+
+  head_ = MakeItem(tokens, 0, token_iter - tokens.begin(), SIZE_MAX);
+  base_stack_ = production_stack;
+  if (!base_stack_.empty()) {
+    base_stack_.pop_back();
+  }
+  subtrees_.push_back(hooks_.wrap(grammar_data, 0, kStartSymbol));
+
+  return ParseItems(grammar_data, tokens, token_iter, {}, {}, 0, {0, 0, 0});
+}
+
+bool IncrementalLLParser::Reparse(void *grammar_data,
+                                  vector<TokenView> &tokens,
+                                  const TokenEdit &edit) {
+  if (!is_parsed_) {
+    return Parse(grammar_data, tokens);
+  }
+
+  size_t old_size = items_.empty() ? head_.last : items_.back().last;
+  if (edit.first + edit.removed_num > old_size
+      || edit.first + edit.inserted_num > tokens.size()
+      || old_size - edit.removed_num + edit.inserted_num != tokens.size()) {
+    logger.error("{}(): the edit ({}, {}, {}) does not match the tokens",
+                 __func__, edit.first, edit.removed_num, edit.inserted_num);
+    return Parse(grammar_data, tokens);
+  }
+
+  // the lookahead of the head is changed
+  if (head_.last >= edit.first) {
+    return Parse(grammar_data, tokens);
+  }
+
+  tokens.push_back(kEofToken.view());
+
+  vector<Item> old_items = move(items_);
+  vector<AstNode *> old_subtrees = move(subtrees_);
+  items_.clear();
+  subtrees_.clear();
+  items_.reserve(old_items.size() + 1);
+  subtrees_.reserve(old_subtrees.size() + 1);
+  is_parsed_ = false;
+
+  // the items before the edit, including their lookahead
+  hooks_.clear(grammar_data);
+  Splice(grammar_data, tokens, head_, old_subtrees[0]);
+  head_ = items_.back();
+  items_.pop_back();
+
+  size_t old_index = 0;
+  while (old_index < old_items.size()
+      && old_items[old_index].last < edit.first) {
+    Splice(grammar_data, tokens, old_items[old_index],
+           old_subtrees[old_index + 1]);
+    old_index += 1;
+  }
+  reused_num_ = items_.size();
+  RestoreStack(items_.size());
+
+  // the old items after the edit
+  while (old_index < old_items.size()
+      && old_items[old_index].first < edit.first + edit.removed_num) {
+    old_index += 1;
+  }
+
+  auto token_iter = tokens.begin()
+      + (items_.empty() ? head_.last : items_.back().last);
+  return ParseItems(grammar_data, tokens, token_iter, old_items, old_subtrees,
+                    old_index, edit);
+}
+
+bool IncrementalLLParser::ParseItems(void *grammar_data,
+                                     vector<TokenView> &tokens,
+                                     vector<TokenView>::iterator token_iter,
+                                     const vector<Item> &old_items,
+                                     const vector<AstNode *> &old_subtrees,
+                                     size_t old_index,
+                                     const TokenEdit &edit) {
+  auto &production_stack = parser_.production_stack_;
+  auto &grammar = parser_.grammar_;
+
+  // the index of old token moved by the edit
+  auto move_index = [&edit](size_t index) {
+    return index + edit.inserted_num - edit.removed_num;
+  };
+
+  bool result = true;
+  while (!production_stack.empty()
+      && !production_stack.back().is_handled
+      && production_stack.back().symbol == item_symbol_) {
+    size_t first = token_iter - tokens.begin();
+
+    while (old_index < old_items.size()
+        && move_index(old_items[old_index].first) < first) {
+      old_index += 1;
+    }
+
+    if (old_index < old_items.size()
+        && move_index(old_items[old_index].first) == first) {
+      // the same state with the old one, so are the rest items
+      for (; old_index < old_items.size(); ++old_index) {
+        Item item = old_items[old_index];
+        item.first = move_index(item.first);
+        item.last = move_index(item.last);
+        Splice(grammar_data, tokens, item, old_subtrees[old_index + 1]);
+        reused_num_ += 1;
+
+        auto &top_state = production_stack.back();
+        top_state.rule_index = item.rule_index;
+        top_state.is_handled = true;
+        production_stack.push_back({item_symbol_, SIZE_MAX, false});
+      }
+      token_iter = tokens.begin() + items_.back().last;
+      break;
+    }
+
+    size_t top_index = production_stack.size() - 1;
+    if (!parser_.ProductNonTerminal(*token_iter)) {
+      result = false;
+      break;
+    }
+
+    size_t rule_index = production_stack[top_index].rule_index;
+    auto &right = grammar.GetRule(rule_index).right();
+    if (1 == right.size() && kEpsilonSymbol == right.front()) {
+      // the end of items
+      break;
+    }
+
+    size_t mark = hooks_.mark(grammar_data);
+    if (!parser_.Run(grammar_data, token_iter, tokens.end(), item_symbol_)) {
+      result = false;
+      break;
+    }
+    items_.push_back(MakeItem(tokens, first, token_iter - tokens.begin(),
+                              rule_index));
+    subtrees_.push_back(hooks_.wrap(grammar_data, mark, right.front()));
+  }
+
+  // the rest after items
+  result = result
+      && parser_.Run(grammar_data, token_iter, tokens.end(), kErrorSymbol)
+      && token_iter->symbol == kEofSymbol;
+
+  if (result) {
+    logger.debug("parsing finished, accept, {} items reused", reused_num_);
+  } else {
+    logger.error("parsing finished, error");
+  }
+
+  is_parsed_ = result;
+  return result;
+}
+
+void IncrementalLLParser::RestoreStack(size_t item_num) {
+  auto &production_stack = parser_.production_stack_;
+  production_stack = base_stack_;
+  for (size_t i = 0; i < item_num; ++i) {
+    production_stack.push_back({item_symbol_, items_[i].rule_index, true});
+  }
+  production_stack.push_back({item_symbol_, SIZE_MAX, false});
+}
+
+IncrementalLLParser::Item IncrementalLLParser::MakeItem(
+    const vector<TokenView> &tokens,
+    size_t first, size_t last, size_t rule_index) const {
+  // the text of LF is not in the source text
+  size_t witness = first;
+  while (witness < last && kLFSymbol == tokens[witness].symbol) {
+    witness += 1;
+  }
+  if (witness < last) {
+    return {first, last, rule_index, witness - first, tokens[witness]};
+  } else {
+    return {first, last, rule_index, SIZE_MAX,
+            TokenView(TextSlice(), kErrorSymbol)};
+  }
+}
+
+void IncrementalLLParser::Splice(void *grammar_data,
+                                 const vector<TokenView> &tokens,
+                                 Item item,
+                                 AstNode *subtree) {
+  bool is_moved = true;
+  if (SIZE_MAX != item.witness) {
+    auto &token = tokens[item.first + item.witness];
+    is_moved = token.text.data() != item.witness_token.text.data()
+        || token.row != item.witness_token.row
+        || token.column != item.witness_token.column;
+  }
+
+  if (is_moved) {
+    hooks_.splice(grammar_data, subtree, tokens.data() + item.first);
+    item = MakeItem(tokens, item.first, item.last, item.rule_index);
+  } else {
+    hooks_.splice(grammar_data, subtree, nullptr);
+  }
+  items_.push_back(item);
+  subtrees_.push_back(subtree);
+}
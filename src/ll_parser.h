@@ -4,32 +4,269 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <set>
-#include <stack>
 #include <unordered_map>
 #include <memory>
+#include <ostream>
 
 #include "grammar.h"
 #include "token.h"
+#include "tokenizer.h"
 
-typedef std::unordered_map<Symbol, std::set<Symbol>> SymbolAuxSet;
-typedef std::vector<std::set<Symbol>> ExtendFirst;
-typedef std::unordered_map<Symbol, std::unordered_map<Symbol, size_t>> LLTable;
+/**
+ * @brief   LL(1) table stored as a contiguous 2D array of rule indices. The
+ *          rows are non-terminals and the columns are terminals, both of which
+ *          are indexed by Grammar::SymbolIndex().
+ */
+class LLTable {
+ public:
+  typedef uint32_t RuleIndex;
+
+  /**
+   * @brief     no rule for the non-terminal and terminal
+   */
+  static constexpr RuleIndex kErrorRule = UINT32_MAX;
+
+  /**
+   * @brief     resize the table, with all the entries being kErrorRule
+   */
+  void Reset(size_t nonterminal_num, size_t terminal_num) {
+    nonterminal_num_ = nonterminal_num;
+    terminal_num_ = terminal_num;
+    table_.assign(nonterminal_num * terminal_num, kErrorRule);
+  }
+
+  RuleIndex Get(size_t nonterminal, size_t terminal) const {
+    return table_[nonterminal * terminal_num_ + terminal];
+  }
+
+  void Set(size_t nonterminal, size_t terminal, RuleIndex rule_index) {
+    table_[nonterminal * terminal_num_ + terminal] = rule_index;
+  }
+
+  size_t nonterminal_num() const {
+    return nonterminal_num_;
+  }
+
+  size_t terminal_num() const {
+    return terminal_num_;
+  }
+
+ private:
+  size_t nonterminal_num_{0};
+  size_t terminal_num_{0};
+  std::vector<RuleIndex> table_;
+};
+
+/**
+ * @brief   a set of terminals, stored as a bitset over Grammar::SymbolIndex()
+ */
+class TerminalSet {
+ public:
+  explicit TerminalSet(size_t terminal_num = 0)
+      : words_((terminal_num + kWordBits - 1) / kWordBits, 0) {}
+
+  bool Test(size_t terminal) const {
+    return terminal / kWordBits < words_.size()
+        && (words_[terminal / kWordBits] >> (terminal % kWordBits) & 1);
+  }
+
+  void Insert(size_t terminal) {
+    words_[terminal / kWordBits] |= uint64_t(1) << (terminal % kWordBits);
+  }
+
+  /**
+   * @brief     merge the terminals of other, except the given one
+   * @return    whether any terminal is inserted
+   */
+  bool Merge(const TerminalSet &other, size_t except = SIZE_MAX) {
+    uint64_t changed = 0;
+    for (size_t i = 0; i < words_.size(); ++i) {
+      uint64_t word = other.words_[i];
+      if (except / kWordBits == i) {
+        word &= ~(uint64_t(1) << (except % kWordBits));
+      }
+      changed |= word & ~words_[i];
+      words_[i] |= word;
+    }
+    return 0 != changed;
+  }
+
+  /**
+   * @brief     call f with the index of each terminal in ascending order
+   */
+  template<class Function>
+  void ForEach(Function f) const {
+    for (size_t i = 0; i < words_.size(); ++i) {
+      for (uint64_t word = words_[i]; word; word &= word - 1) {
+        f(i * kWordBits + __builtin_ctzll(word));
+      }
+    }
+  }
+
+  bool operator==(const TerminalSet &rhs) const {
+    return words_ == rhs.words_;
+  }
+
+ private:
+  static constexpr size_t kWordBits = 64;
+
+  std::vector<uint64_t> words_;
+};
+
+/**
+ * @brief   FIRST and FOLLOW sets of the non-terminals, as bitsets of terminals
+ *
+ * @details The sets are computed by a worklist: a rule is visited again only
+ *          when the FIRST of a symbol in its right part, or the FOLLOW of its
+ *          left, is changed. The sets only grow when rules are added, so the
+ *          sets of a grammar extended by GrammarBuilder are updated from the
+ *          old ones, by visiting the new rules and the rules depending on the
+ *          changed sets. FIRST of a nullable symbol contains Epsilon.
+ */
+class FirstFollow {
+ public:
+  /**
+   * @brief     compute the sets for the rules appended since last update, or
+   *            for all the rules if the symbols are numbered differently
+   */
+  void Update(const Grammar &grammar);
+
+  const TerminalSet &first(size_t nonterminal) const {
+    return firsts_[nonterminal];
+  }
+
+  const TerminalSet &follow(size_t nonterminal) const {
+    return follows_[nonterminal];
+  }
+
+  /**
+   * @brief     FIRST+ of a rule, which is FIRST of the right part, and FOLLOW
+   *            of the left if the right part is nullable
+   */
+  TerminalSet RuleFirst(const Grammar &grammar, size_t rule_index) const;
+
+  /**
+   * @return    the number of rules visited by last update
+   */
+  size_t visited_num() const {
+    return visited_num_;
+  }
+
+ private:
+  void Reset(const Grammar &grammar);
+
+  /**
+   * @brief     merge FIRST of the symbol into set, without Epsilon
+   * @return    whether the symbol is nullable
+   */
+  bool MergeFirst(const Grammar &grammar, const Symbol &symbol,
+                  TerminalSet &set) const;
+
+  void UpdateFirst(const Grammar &grammar, std::vector<size_t> &worklist,
+                   std::vector<bool> &is_first_changed);
+
+  void UpdateFollow(const Grammar &grammar, std::vector<size_t> &worklist);
+
+ private:
+  std::vector<Symbol> terminals_;
+  std::vector<Symbol> nonterminals_;
+  size_t epsilon_{SIZE_MAX};
+  size_t rule_num_{0};
+  size_t visited_num_{0};
+
+  std::vector<TerminalSet> firsts_;
+  std::vector<TerminalSet> follows_;
+
+  /**
+   * @brief     the rules by their left, and by the non-terminals in their
+   *            right parts
+   */
+  std::vector<std::vector<size_t>> rules_of_left_;
+  std::vector<std::vector<size_t>> rules_of_right_;
+};
 
 /**
- * Build LL(1) table
+ * @brief   two rules of a non-terminal predicted by the same terminal, the
+ *          current one is kept in the table
  */
-SymbolAuxSet CalcFirst(const Grammar &grammar);
-SymbolAuxSet CalcFollow(const Grammar &grammar, const SymbolAuxSet &firsts);
-ExtendFirst CalcExtendFirst(const Grammar &grammar,
-                            const SymbolAuxSet &firsts,
-                            const SymbolAuxSet &follows);
+struct LLConflict {
+  size_t nonterminal;
+  size_t terminal;
+  size_t curr_rule;
+  size_t new_rule;
+};
+
+/**
+ * @brief   diagnostics of building LL(1) table, collected only on request.
+ *          The sets and the table are indexed by Grammar::SymbolIndex().
+ */
+struct LLTableReport {
+  std::vector<TerminalSet> firsts;
+  std::vector<TerminalSet> follows;
+  std::vector<TerminalSet> rule_firsts;
+  std::vector<LLConflict> conflicts;
+  bool is_too_many_rules;
+  size_t entry_num;
+  size_t visited_num;
+};
+
+/**
+ * Build LL(1) table, which does no I/O
+ *
+ * @param report    if not nullptr, collect the sets and all the conflicts,
+ *                  instead of stopping at the first conflict
+ * @return          whether no conflict
+ */
+bool BuildLLTable(const Grammar &grammar,
+                  const FirstFollow &first_follow,
+                  LLTable &ll_table,
+                  LLTableReport *report = nullptr);
 
 bool BuildLLTable(const Grammar &grammar,
-                  const ExtendFirst &extend_firsts,
-                  LLTable &ll_table);
+                  LLTable &ll_table,
+                  LLTableReport *report = nullptr);
 
-bool BuildLLTable(const Grammar &grammar, LLTable &ll_table);
+/**
+ * @brief   dump a report in text, for tools and debugging
+ */
+void PrintLLTableReport(std::ostream &os,
+                        const Grammar &grammar,
+                        const LLTableReport &report);
+
+/**
+ * @brief   a binary operator of an expression parsed by precedence climbing
+ */
+struct BinaryOperator {
+  Symbol symbol;
+
+  /**
+   * @brief     positive, the greater one binds tighter
+   */
+  int precedence;
+  bool is_right_assoc;
+};
+
+/**
+ * @brief   The callbacks on grammar data used by precedence climbing. An
+ *          operator is reduced with its two operands, all the nodes of which
+ *          are produced after the mark of left operand.
+ */
+struct OperatorHooks {
+  /**
+   * @return    the number of nodes produced
+   */
+  std::function<size_t(void *)> mark;
+
+  /**
+   * @brief     reduce the nodes since the mark of left operand into one, the
+   *            operator node is at the mark of operator, the right operand
+   *            follows it
+   */
+  std::function<void(void *, size_t, size_t)> reduce;
+};
 
 /**
  * @brief LL(1) Parser
@@ -46,18 +283,255 @@ class LLParser {
   LLParser(const Grammar &grammar, const LLTable &ll_table) :
       grammar_(grammar), ll_table_(ll_table) {}
 
-  bool Parse(void *grammar_data, std::vector<Token> &tokens);
+  /**
+   * @brief     a EOF token is appended to tokens
+   */
+  bool Parse(void *grammar_data, std::vector<TokenView> &tokens);
+
+  /**
+   * @brief     the tokens are fed as views, so they should outlive the AST
+   */
+  bool Parse(void *grammar_data, const std::vector<Token> &tokens);
+
+  /**
+   * @brief     Pull the tokens from cursor on demand with one token of
+   *            lookahead, instead of lexing the whole text first. A EOF token
+   *            follows the last one.
+   * @return    false if a lexing or parsing error occurs
+   */
+  bool Parse(void *grammar_data, TokenizerCursor &cursor);
+
+  /**
+   * @brief     Parse the expression non-terminal by precedence climbing:
+   *              expr -> operand (operator operand)*
+   *            instead of its rules, the operands are parsed by the rules of
+   *            operand. The snippets of the rules under expr and above operand
+   *            are not called, but the reduce hook once per operator.
+   *
+   * @details   The operators should be the terminals which may follow an
+   *            operand in the rules of expr, so that the same tokens are
+   *            accepted.
+   *
+   * @return    false if the symbols are not in grammar
+   */
+  bool SetOperatorTable(const Symbol &expr, const Symbol &operand,
+                        const std::vector<BinaryOperator> &operators,
+                        OperatorHooks hooks);
 
  private:
+  friend class IncrementalLLParser;
+
+  /**
+   * @brief     the binary operators indexed by terminal, the precedence of a
+   *            terminal not operator is zero
+   */
+  struct OperatorTable {
+    Symbol operand;
+    std::vector<int> precedences;
+    std::vector<bool> is_right_assoc;
+    OperatorHooks hooks;
+  };
+
+  /**
+   * @brief     an operator waiting for its right operand
+   */
+  struct PendingOperator {
+    int precedence;
+    size_t mark;
+  };
+
+  /**
+   * @brief     run the predictive loop until the stack is empty, or the top
+   *            is the stop symbol not expanded yet
+   * @return    false if a parsing error occurs
+   */
+  bool Run(void *grammar_data,
+           std::vector<TokenView>::iterator &token_iter,
+           const std::vector<TokenView>::iterator &token_end,
+           const Symbol &stop_symbol);
+
+  /**
+   * @brief     The token sources are defined in the source file, which have
+   *            IsEnd(), Peek() and Advance().
+   */
+  template <typename TokenSource>
+  bool ParseTokens(void *grammar_data, TokenSource &tokens);
+
+  /**
+   * @brief     run the predictive loop until the stack is no deeper than base
+   *            depth, or the top is the stop symbol not expanded yet
+   * @return    false if a parsing error occurs
+   */
+  template <typename TokenSource>
+  bool Run(void *grammar_data,
+           TokenSource &tokens,
+           const Symbol &stop_symbol,
+           size_t base_depth = 0);
+
+  /**
+   * @brief     parse an expression by precedence climbing, the operands are
+   *            parsed by running the predictive loop above current stack
+   */
+  template <typename TokenSource>
+  bool ParseOperators(void *grammar_data,
+                      TokenSource &tokens,
+                      const OperatorTable &table);
+
+  template <typename TokenSource>
   bool ProductTerminal(void *grammar_data,
                        StackState &top_state,
-                       std::vector<Token>::iterator &token_iter);
+                       TokenSource &tokens);
 
-  bool ProductNonTerminal(StackState &top_state,
-                          const Token &token);
+  /**
+   * @brief     expand the non-terminal on the top of stack, which is marked as
+   *            handled, and the right part is pushed above it
+   */
+  bool ProductNonTerminal(const TokenView &token);
 
  private:
   const Grammar &grammar_;
   const LLTable &ll_table_;
-  std::stack<StackState> production_stack_;
+  std::vector<StackState> production_stack_;
+
+  /**
+   * @brief     the index of operator table by non-terminal, SIZE_MAX if none
+   */
+  std::vector<size_t> operator_table_index_;
+  std::vector<OperatorTable> operator_tables_;
+  std::vector<PendingOperator> operator_stack_;
+  std::vector<size_t> operand_marks_;
+};
+
+/**
+ * @brief   The callbacks on grammar data used by incremental parsing. The nodes
+ *          produced by parsing a top-level item are wrapped into a subtree,
+ *          which refers to the tokens of the item.
+ */
+struct SubtreeHooks {
+  /**
+   * @brief     drop all the nodes produced, before parsing again
+   */
+  std::function<void(void *)> clear;
+
+  /**
+   * @return    the number of nodes produced and not wrapped
+   */
+  std::function<size_t(void *)> mark;
+
+  /**
+   * @brief     wrap the nodes produced after the mark into a subtree
+   */
+  std::function<AstNode *(void *, size_t, const Symbol &)> wrap;
+
+  /**
+   * @brief     append a subtree parsed before, the nodes of which fetch the
+   *            tokens of the item from the given one in order, or keep their
+   *            tokens if it is nullptr
+   */
+  std::function<void(void *, AstNode *, const TokenView *)> splice;
+};
+
+/**
+ * @brief   LL(1) Parser reusing the subtrees of unchanged top-level items
+ *
+ * @details The items are the expansions of a right recursive symbol, such as
+ *          a list of declarations, which appears only at the top level. When
+ *          the symbol is on the top of stack, the stack below it is decided by
+ *          the items before, so an item parsed from there depends only on its
+ *          tokens and the lookahead after them. After an edit, the items before
+ *          it are kept, and the parsing starts from the end of them until it
+ *          reaches the start of an old item after the edit. The subtrees of
+ *          the rest items are spliced back without parsing.
+ */
+class IncrementalLLParser {
+ public:
+  IncrementalLLParser(const Grammar &grammar, const LLTable &ll_table,
+                      const Symbol &item_symbol, SubtreeHooks hooks)
+      : parser_(grammar, ll_table),
+        item_symbol_(item_symbol),
+        hooks_(std::move(hooks)),
+        head_{0, 0, SIZE_MAX, SIZE_MAX, TokenView(TextSlice(), kErrorSymbol)} {}
+
+  /**
+   * @brief     parse all the tokens, a EOF token is appended to tokens
+   * @return    whether accept
+   */
+  bool Parse(void *grammar_data, std::vector<TokenView> &tokens);
+
+  /**
+   * @brief     parse the tokens after an edit, with the same grammar data of
+   *            last parsing
+   * @param edit    the tokens replaced since last parsing
+   * @return        whether accept
+   */
+  bool Reparse(void *grammar_data, std::vector<TokenView> &tokens,
+               const TokenEdit &edit);
+
+  /**
+   * @brief     the subtrees of last parsing, the first one of kStartSymbol is
+   *            the part before items
+   */
+  const std::vector<AstNode *> &subtrees() const {
+    return subtrees_;
+  }
+
+  /**
+   * @return    the number of items reused by last parsing
+   */
+  size_t reused_num() const {
+    return reused_num_;
+  }
+
+ private:
+  /**
+   * @brief     the tokens parsed as an item are [first, last), and the token
+   *            at last is the lookahead. The tokens of an item are moved
+   *            together by an edit, so a token not LF in it is recorded to
+   *            check whether they are moved.
+   */
+  struct Item {
+    size_t first;
+    size_t last;
+    size_t rule_index;
+    size_t witness;
+    TokenView witness_token;
+  };
+
+  Item MakeItem(const std::vector<TokenView> &tokens,
+                size_t first, size_t last, size_t rule_index) const;
+
+  /**
+   * @brief     append the subtree of item, which fetches the tokens again only
+   *            if they are moved
+   */
+  void Splice(void *grammar_data, const std::vector<TokenView> &tokens,
+              Item item, AstNode *subtree);
+
+  /**
+   * @brief     parse from current state to the end, and reuse the old items
+   *            from old_index if the parsing reaches one of them
+   */
+  bool ParseItems(void *grammar_data, std::vector<TokenView> &tokens,
+                  std::vector<TokenView>::iterator token_iter,
+                  const std::vector<Item> &old_items,
+                  const std::vector<AstNode *> &old_subtrees,
+                  size_t old_index, const TokenEdit &edit);
+
+  /**
+   * @brief     the stack after the first kept items, with the item symbol on
+   *            the top
+   */
+  void RestoreStack(size_t item_num);
+
+ private:
+  LLParser parser_;
+  Symbol item_symbol_;
+  SubtreeHooks hooks_;
+
+  std::vector<LLParser::StackState> base_stack_;
+  Item head_;
+  std::vector<Item> items_;
+  std::vector<AstNode *> subtrees_;
+  size_t reused_num_{0};
+  bool is_parsed_{false};
 };
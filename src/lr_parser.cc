@@ -0,0 +1,547 @@
+//
+// Created by Dyinnz on 16-10-18.
+//
+
+#include "lr_parser.h"
+#include "simplelogger.h"
+
+#include <map>
+
+using std::vector;
+using std::map;
+using std::pair;
+
+extern simple_logger::BaseLogger logger;
+
+constexpr LRTable::Action LRTable::kErrorAction;
+constexpr LRTable::Action LRTable::kAcceptAction;
+
+void LRTable::PackedRows::Pack(const vector<SparseRow> &rows) {
+  base.assign(rows.size(), 0);
+  entries.clear();
+  check.clear();
+
+  // the dense rows are placed first, when the array is still sparse
+  vector<size_t> order(rows.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return rows[lhs].size() > rows[rhs].size();
+  });
+
+  for (size_t row : order) {
+    if (rows[row].empty()) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (;; ++offset) {
+      bool is_free = true;
+      for (auto &entry : rows[row]) {
+        size_t index = offset + entry.first;
+        if (index < check.size() && -1 != check[index]) {
+          is_free = false;
+          break;
+        }
+      }
+      if (is_free) {
+        break;
+      }
+    }
+
+    base[row] = offset;
+    for (auto &entry : rows[row]) {
+      size_t index = offset + entry.first;
+      if (index >= check.size()) {
+        check.resize(index + 1, -1);
+        entries.resize(index + 1, 0);
+      }
+      check[index] = static_cast<int32_t>(row);
+      entries[index] = entry.second;
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+
+/**
+ * @brief   the states of LR(0) items and the lookaheads of their kernels. An
+ *          item is a position in the right part of a rule, numbered by
+ *          item_base_[rule] + dot. The augmented rule Start' -> Start is the
+ *          last rule.
+ */
+class LRTableBuilder {
+ public:
+  LRTableBuilder(const Grammar &grammar, const FirstFollow &first_follow)
+      : grammar_(grammar), first_follow_(first_follow),
+        terminal_num_(grammar.terminals().size()),
+        dummy_(grammar.terminals().size()),
+        augmented_rule_(grammar.RuleNumber()) {}
+
+  bool Build(LRTable &lr_table, LRTableReport *report);
+
+ private:
+  typedef vector<uint32_t> Kernel;
+
+  struct State {
+    Kernel kernel;
+    vector<TerminalSet> lookaheads;
+    map<Symbol, size_t> gotos;
+  };
+
+  /**
+   * @brief     lookahead sets have a dummy terminal at the end
+   */
+  TerminalSet EmptySet() const {
+    return TerminalSet(terminal_num_ + 1);
+  }
+
+  void NumberItems();
+
+  size_t ItemRule(uint32_t item) const {
+    return item_rules_[item];
+  }
+
+  size_t ItemDot(uint32_t item) const {
+    return item - item_base_[item_rules_[item]];
+  }
+
+  /**
+   * @return    the symbol after dot, or nullptr if the dot is at the end
+   */
+  const Symbol *NextSymbol(uint32_t item) const {
+    auto &right = rights_[ItemRule(item)];
+    size_t dot = ItemDot(item);
+    return dot < right.size() ? &right[dot] : nullptr;
+  }
+
+  /**
+   * @brief     LR(0) closure of a kernel, in the order of items
+   */
+  vector<uint32_t> Closure(const Kernel &kernel) const;
+
+  /**
+   * @brief     LR(1) closure with lookahead sets
+   */
+  map<uint32_t, TerminalSet> Closure(const Kernel &kernel,
+                                     const vector<TerminalSet> &lookaheads)
+                                     const;
+
+  /**
+   * @brief     merge FIRST of the symbols after dot into set
+   * @return    whether they are nullable
+   */
+  bool MergeFirstAfter(uint32_t item, TerminalSet &set) const;
+
+  void BuildStates();
+  void BuildLookaheads();
+
+  size_t KernelIndex(const State &state, uint32_t item) const {
+    return std::lower_bound(state.kernel.begin(), state.kernel.end(), item)
+        - state.kernel.begin();
+  }
+
+ private:
+  const Grammar &grammar_;
+  const FirstFollow &first_follow_;
+  size_t terminal_num_;
+  size_t dummy_;
+  size_t augmented_rule_;
+
+  vector<Sequence> rights_;
+  vector<vector<size_t>> rules_of_left_;
+  vector<uint32_t> item_base_;
+  vector<size_t> item_rules_;
+
+  vector<State> states_;
+};
+
+void LRTableBuilder::NumberItems() {
+  rights_.clear();
+  rules_of_left_.assign(grammar_.nonterminals().size(), {});
+  item_base_.clear();
+  item_rules_.clear();
+
+  for (size_t i = 0; i <= augmented_rule_; ++i) {
+    Sequence right;
+    if (i == augmented_rule_) {
+      right.push_back(kStartSymbol);
+    } else {
+      auto &rule = grammar_.GetRule(i);
+      rules_of_left_[grammar_.SymbolIndex(rule.left())].push_back(i);
+      for (auto &symbol : rule.right()) {
+        if (symbol != kEpsilonSymbol) {
+          right.push_back(symbol);
+        }
+      }
+    }
+
+    item_base_.push_back(static_cast<uint32_t>(item_rules_.size()));
+    item_rules_.insert(item_rules_.end(), right.size() + 1, i);
+    rights_.push_back(std::move(right));
+  }
+}
+
+vector<uint32_t> LRTableBuilder::Closure(const Kernel &kernel) const {
+  vector<uint32_t> items(kernel);
+  vector<bool> is_added(grammar_.nonterminals().size(), false);
+
+  for (size_t i = 0; i < items.size(); ++i) {
+    auto next = NextSymbol(items[i]);
+    if (!next || next->IsTerminal()) {
+      continue;
+    }
+    size_t nonterminal = grammar_.SymbolIndex(*next);
+    if (is_added[nonterminal]) {
+      continue;
+    }
+    is_added[nonterminal] = true;
+    for (size_t rule_index : rules_of_left_[nonterminal]) {
+      items.push_back(item_base_[rule_index]);
+    }
+  }
+  return items;
+}
+
+bool LRTableBuilder::MergeFirstAfter(uint32_t item, TerminalSet &set) const {
+  auto &right = rights_[ItemRule(item)];
+  size_t epsilon = grammar_.SymbolIndex(kEpsilonSymbol);
+
+  for (size_t i = ItemDot(item) + 1; i < right.size(); ++i) {
+    size_t index = grammar_.SymbolIndex(right[i]);
+    if (right[i].IsTerminal()) {
+      set.Insert(index);
+      return false;
+    }
+    auto &first = first_follow_.first(index);
+    first.ForEach([&](size_t terminal) {
+      if (terminal != epsilon) {
+        set.Insert(terminal);
+      }
+    });
+    if (!first.Test(epsilon)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+map<uint32_t, TerminalSet> LRTableBuilder::Closure(
+    const Kernel &kernel, const vector<TerminalSet> &lookaheads) const {
+  map<uint32_t, TerminalSet> items;
+  vector<uint32_t> worklist;
+  for (size_t i = 0; i < kernel.size(); ++i) {
+    items.insert(std::make_pair(kernel[i], lookaheads[i]));
+    worklist.push_back(kernel[i]);
+  }
+
+  while (!worklist.empty()) {
+    uint32_t item = worklist.back();
+    worklist.pop_back();
+
+    auto next = NextSymbol(item);
+    if (!next || next->IsTerminal()) {
+      continue;
+    }
+
+    // [A -> a.Bb, L] adds [B -> .c, First(b) & (L if b is nullable)]
+    auto inserted = EmptySet();
+    if (MergeFirstAfter(item, inserted)) {
+      inserted.Merge(items.find(item)->second);
+    }
+
+    for (size_t rule_index : rules_of_left_[grammar_.SymbolIndex(*next)]) {
+      uint32_t start = item_base_[rule_index];
+      auto iter = items.find(start);
+      if (items.end() == iter) {
+        items.insert(std::make_pair(start, inserted));
+        worklist.push_back(start);
+      } else if (iter->second.Merge(inserted)) {
+        worklist.push_back(start);
+      }
+    }
+  }
+  return items;
+}
+
+void LRTableBuilder::BuildStates() {
+  states_.clear();
+  map<Kernel, size_t> kernel_to_state;
+
+  Kernel start_kernel{item_base_[augmented_rule_]};
+  kernel_to_state[start_kernel] = 0;
+  states_.push_back({start_kernel, {}, {}});
+
+  for (size_t i = 0; i < states_.size(); ++i) {
+    // group the items by the symbol after dot
+    map<Symbol, Kernel> next_kernels;
+    for (uint32_t item : Closure(states_[i].kernel)) {
+      auto next = NextSymbol(item);
+      if (next) {
+        next_kernels[*next].push_back(item + 1);
+      }
+    }
+
+    for (auto &pair : next_kernels) {
+      Kernel &kernel = pair.second;
+      std::sort(kernel.begin(), kernel.end());
+      auto result = kernel_to_state.insert(
+          std::make_pair(kernel, states_.size()));
+      if (result.second) {
+        states_.push_back({kernel, {}, {}});
+      }
+      states_[i].gotos[pair.first] = result.first->second;
+    }
+  }
+
+  for (auto &state : states_) {
+    state.lookaheads.assign(state.kernel.size(), EmptySet());
+  }
+}
+
+void LRTableBuilder::BuildLookaheads() {
+  // the propagation edges from a kernel item to the kernel items of gotos
+  typedef pair<size_t, size_t> KernelItem;
+  map<KernelItem, vector<KernelItem>> propagations;
+
+  size_t eof = grammar_.SymbolIndex(kEofSymbol);
+  if (eof < terminal_num_) {
+    states_[0].lookaheads[0].Insert(eof);
+  }
+
+  for (size_t i = 0; i < states_.size(); ++i) {
+    auto &state = states_[i];
+    for (size_t k = 0; k < state.kernel.size(); ++k) {
+      auto dummy_set = EmptySet();
+      dummy_set.Insert(dummy_);
+
+      for (auto &pair : Closure({state.kernel[k]}, {dummy_set})) {
+        auto next = NextSymbol(pair.first);
+        if (!next) {
+          continue;
+        }
+        size_t target = state.gotos.find(*next)->second;
+        size_t target_index = KernelIndex(states_[target], pair.first + 1);
+
+        // the lookaheads other than dummy are generated spontaneously
+        auto &lookahead = states_[target].lookaheads[target_index];
+        pair.second.ForEach([&](size_t terminal) {
+          if (terminal != dummy_) {
+            lookahead.Insert(terminal);
+          }
+        });
+        if (pair.second.Test(dummy_)) {
+          propagations[{i, k}].push_back({target, target_index});
+        }
+      }
+    }
+  }
+
+  bool is_change = true;
+  while (is_change) {
+    is_change = false;
+    for (auto &pair : propagations) {
+      auto &from = states_[pair.first.first].lookaheads[pair.first.second];
+      for (auto &to : pair.second) {
+        if (states_[to.first].lookaheads[to.second].Merge(from)) {
+          is_change = true;
+        }
+      }
+    }
+  }
+}
+
+bool LRTableBuilder::Build(LRTable &lr_table, LRTableReport *report) {
+  NumberItems();
+  BuildStates();
+  BuildLookaheads();
+
+  bool is_conflict = false;
+  vector<LRTable::SparseRow> action_rows(states_.size());
+  vector<LRTable::SparseRow> goto_rows(states_.size());
+
+  for (size_t i = 0; i < states_.size(); ++i) {
+    auto &state = states_[i];
+    map<size_t, LRTable::Action> actions;
+
+    auto set_action = [&](size_t terminal, LRTable::Action action) {
+      auto result = actions.insert(std::make_pair(terminal, action));
+      if (!result.second && result.first->second != action) {
+        is_conflict = true;
+        if (report) {
+          report->conflicts.push_back({i, terminal, result.first->second,
+                                       action});
+        }
+      }
+    };
+
+    for (auto &pair : state.gotos) {
+      if (pair.first.IsTerminal()) {
+        set_action(grammar_.SymbolIndex(pair.first),
+                   LRTable::Shift(pair.second));
+      } else {
+        goto_rows[i].push_back({grammar_.SymbolIndex(pair.first),
+                                static_cast<int32_t>(pair.second)});
+      }
+    }
+
+    for (auto &pair : Closure(state.kernel, state.lookaheads)) {
+      if (NextSymbol(pair.first)) {
+        continue;
+      }
+      size_t rule_index = ItemRule(pair.first);
+      LRTable::Action action = augmented_rule_ == rule_index
+                               ? LRTable::kAcceptAction
+                               : LRTable::Reduce(rule_index);
+      pair.second.ForEach([&](size_t terminal) {
+        if (terminal != dummy_) {
+          set_action(terminal, action);
+        }
+      });
+    }
+
+    for (auto &pair : actions) {
+      action_rows[i].push_back(pair);
+    }
+    std::sort(goto_rows[i].begin(), goto_rows[i].end());
+  }
+
+  lr_table.actions_.Pack(action_rows);
+  lr_table.gotos_.Pack(goto_rows);
+
+  if (report) {
+    report->state_num = states_.size();
+    report->entry_num = 0;
+    for (size_t i = 0; i < states_.size(); ++i) {
+      report->entry_num += action_rows[i].size() + goto_rows[i].size();
+    }
+    report->dense_size = states_.size()
+        * (grammar_.terminals().size() + grammar_.nonterminals().size());
+    report->packed_size = lr_table.packed_size();
+  }
+  return !is_conflict;
+}
+
+bool BuildLRTable(const Grammar &grammar,
+                  const FirstFollow &first_follow,
+                  LRTable &lr_table,
+                  LRTableReport *report) {
+  if (report) {
+    *report = LRTableReport();
+  }
+  if (grammar.SymbolIndex(kStartSymbol) >= grammar.nonterminals().size()
+      || grammar.RuleNumber() >= static_cast<size_t>(INT32_MAX)) {
+    return false;
+  }
+
+  LRTableBuilder builder(grammar, first_follow);
+  return builder.Build(lr_table, report);
+}
+
+bool BuildLRTable(const Grammar &grammar,
+                  LRTable &lr_table,
+                  LRTableReport *report) {
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
+  return BuildLRTable(grammar, first_follow, lr_table, report);
+}
+
+void PrintLRTableReport(std::ostream &os,
+                        const Grammar &grammar,
+                        const LRTableReport &report) {
+  auto print_action = [&](LRTable::Action action) {
+    if (LRTable::IsShift(action)) {
+      os << "shift " << LRTable::ShiftState(action);
+    } else if (LRTable::IsReduce(action)) {
+      os << "reduce " << grammar.GetRule(LRTable::ReduceRule(action));
+    } else {
+      os << "accept";
+    }
+  };
+
+  for (auto &conflict : report.conflicts) {
+    os << "LALR(1) conflict on state " << conflict.state << " terminal "
+       << grammar.terminals()[conflict.terminal] << ",\n"
+       << "  curr action: ";
+    print_action(conflict.curr_action);
+    os << "\n   new action: ";
+    print_action(conflict.new_action);
+    os << '\n';
+  }
+  os << report.state_num << " states, "
+     << report.entry_num << " entries, "
+     << report.conflicts.size() << " conflicts, "
+     << report.packed_size << " packed slots of "
+     << report.dense_size << '\n';
+}
+
+/*----------------------------------------------------------------------------*/
+
+LRParser::LRParser(const Grammar &grammar, const LRTable &lr_table)
+    : grammar_(grammar), lr_table_(lr_table) {
+  for (auto &rule : grammar.AllRules()) {
+    rule_lengths_.push_back(static_cast<size_t>(
+        std::count_if(rule.right().begin(), rule.right().end(),
+                      [](const Symbol &symbol) {
+                        return symbol != kEpsilonSymbol;
+                      })));
+    rule_lefts_.push_back(grammar.SymbolIndex(rule.left()));
+  }
+}
+
+bool LRParser::Parse(void *grammar_data, const vector<Token> &tokens) {
+  vector<TokenView> token_views;
+  token_views.reserve(tokens.size() + 1);
+  for (auto &token : tokens) {
+    token_views.push_back(token.view());
+  }
+  return Parse(grammar_data, token_views);
+}
+
+bool LRParser::Parse(void *grammar_data, vector<TokenView> &tokens) {
+  tokens.push_back(kEofToken.view());
+
+  auto token_iter = tokens.begin();
+  state_stack_.clear();
+  state_stack_.push_back(0);
+
+  bool result = false;
+  while (true) {
+    size_t terminal = grammar_.SymbolIndex(token_iter->symbol);
+    LRTable::Action action = token_iter->symbol.IsTerminal()
+                             && SIZE_MAX != terminal
+                             ? lr_table_.GetAction(state_stack_.back(),
+                                                   terminal)
+                             : LRTable::kErrorAction;
+
+    if (LRTable::IsShift(action)) {
+      grammar_.token_feeder()(grammar_data, *token_iter);
+      state_stack_.push_back(LRTable::ShiftState(action));
+      ++token_iter;
+
+    } else if (LRTable::IsReduce(action)) {
+      size_t rule_index = LRTable::ReduceRule(action);
+      state_stack_.resize(state_stack_.size() - rule_lengths_[rule_index]);
+      state_stack_.push_back(lr_table_.GetGoto(state_stack_.back(),
+                                               rule_lefts_[rule_index]));
+      grammar_.GetRule(rule_index).snippet()(grammar_data);
+
+    } else if (LRTable::kAcceptAction == action) {
+      result = true;
+      break;
+
+    } else {
+      logger.error("no LALR(1) action: state {}, token {}",
+                   state_stack_.back(), to_string(*token_iter));
+      break;
+    }
+  }
+
+  if (result) {
+    logger.debug("parsing finished, accept");
+  } else {
+    logger.error("parsing finished, error");
+  }
+  return result;
+}
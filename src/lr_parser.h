@@ -0,0 +1,185 @@
+//
+// Created by Dyinnz on 16-10-18.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "grammar.h"
+#include "ll_parser.h"
+#include "token.h"
+
+/**
+ * @brief   LALR(1) ACTION and GOTO tables. The rows are states, the columns
+ *          are terminals or non-terminals indexed by Grammar::SymbolIndex().
+ *
+ * @details The rows are compressed by row displacement: all the rows are
+ *          packed into one array, a row starts at its base, and the entries
+ *          of other rows overlapping it are told by the check array. A row
+ *          is placed at the first base where its entries fall into free slots.
+ */
+class LRTable {
+ public:
+  /**
+   * @brief     positive for shifting to state (action - 1), negative for
+   *            reducing by rule (-action - 1), zero for error
+   */
+  typedef int32_t Action;
+
+  static constexpr Action kErrorAction = 0;
+  static constexpr Action kAcceptAction = INT32_MIN;
+
+  static Action Shift(size_t state) {
+    return static_cast<Action>(state + 1);
+  }
+
+  static Action Reduce(size_t rule_index) {
+    return -static_cast<Action>(rule_index + 1);
+  }
+
+  static bool IsShift(Action action) {
+    return action > 0;
+  }
+
+  static bool IsReduce(Action action) {
+    return action < 0 && kAcceptAction != action;
+  }
+
+  static size_t ShiftState(Action action) {
+    return static_cast<size_t>(action - 1);
+  }
+
+  static size_t ReduceRule(Action action) {
+    return static_cast<size_t>(-action - 1);
+  }
+
+  Action GetAction(size_t state, size_t terminal) const {
+    return actions_.Get(state, terminal, kErrorAction);
+  }
+
+  /**
+   * @return    the next state, or SIZE_MAX if none
+   */
+  size_t GetGoto(size_t state, size_t nonterminal) const {
+    int32_t next = gotos_.Get(state, nonterminal, -1);
+    return next < 0 ? SIZE_MAX : static_cast<size_t>(next);
+  }
+
+  size_t state_num() const {
+    return actions_.base.size();
+  }
+
+  /**
+   * @return    the number of slots of the packed arrays
+   */
+  size_t packed_size() const {
+    return actions_.entries.size() + gotos_.entries.size();
+  }
+
+ private:
+  friend class LRTableBuilder;
+
+  typedef std::vector<std::pair<size_t, int32_t>> SparseRow;
+
+  struct PackedRows {
+    std::vector<size_t> base;
+    std::vector<int32_t> entries;
+    std::vector<int32_t> check;
+
+    int32_t Get(size_t row, size_t column, int32_t empty) const {
+      size_t index = base[row] + column;
+      return index < check.size() && static_cast<int32_t>(row) == check[index]
+             ? entries[index] : empty;
+    }
+
+    void Pack(const std::vector<SparseRow> &rows);
+  };
+
+  PackedRows actions_;
+  PackedRows gotos_;
+};
+
+/**
+ * @brief   two actions of a state on the same terminal, the current one is
+ *          kept in the table
+ */
+struct LRConflict {
+  size_t state;
+  size_t terminal;
+  LRTable::Action curr_action;
+  LRTable::Action new_action;
+};
+
+/**
+ * @brief   diagnostics of building LALR(1) table, collected only on request
+ */
+struct LRTableReport {
+  std::vector<LRConflict> conflicts;
+  size_t state_num;
+  size_t entry_num;
+  size_t dense_size;
+  size_t packed_size;
+};
+
+/**
+ * Build LALR(1) table, which does no I/O
+ *
+ * @details The LR(0) states are built from the start rules, and the
+ *          lookaheads of kernel items are generated spontaneously or
+ *          propagated, by the closures of kernel items with a dummy
+ *          lookahead. Epsilon in a right part matches nothing, so that the
+ *          rules written for LLParser are accepted.
+ *
+ * @param report    if not nullptr, collect all the conflicts and sizes
+ * @return          whether no conflict
+ */
+bool BuildLRTable(const Grammar &grammar,
+                  const FirstFollow &first_follow,
+                  LRTable &lr_table,
+                  LRTableReport *report = nullptr);
+
+bool BuildLRTable(const Grammar &grammar,
+                  LRTable &lr_table,
+                  LRTableReport *report = nullptr);
+
+/**
+ * @brief   dump a report in text, for tools and debugging
+ */
+void PrintLRTableReport(std::ostream &os,
+                        const Grammar &grammar,
+                        const LRTableReport &report);
+
+/**
+ * @brief   LALR(1) shift-reduce parser, the token feeder is called on shift,
+ *          and the snippet of a rule on reduce. The callbacks are in the same
+ *          order of LLParser for the same parse tree.
+ */
+class LRParser {
+ public:
+  LRParser(const Grammar &grammar, const LRTable &lr_table);
+
+  /**
+   * @brief     a EOF token is appended to tokens
+   */
+  bool Parse(void *grammar_data, std::vector<TokenView> &tokens);
+
+  /**
+   * @brief     the tokens are fed as views, so they should outlive the AST
+   */
+  bool Parse(void *grammar_data, const std::vector<Token> &tokens);
+
+ private:
+  const Grammar &grammar_;
+  const LRTable &lr_table_;
+
+  /**
+   * @brief     the length without Epsilon, and the dense index of left
+   */
+  std::vector<size_t> rule_lengths_;
+  std::vector<size_t> rule_lefts_;
+
+  std::vector<size_t> state_stack_;
+};
@@ -13,6 +13,7 @@
 #include "regex_parser.h"
 #include "tokenizer.h"
 #include "ll_parser.h"
+#include "batch_driver.h"
 
 #include "expr_grammar.h"
 #include "golike_grammar.h"
@@ -37,17 +38,21 @@ void Example() {
 void TEST_ExprGrammar() {
   Grammar grammar = expr_grammar::BuildExprGrammar();
   LLTable ll_table;
-  bool result = BuildLLTable(grammar, ll_table);
+  LLTableReport report;
+  BuildLLTable(grammar, ll_table, &report);
+  PrintLLTableReport(cout, grammar, report);
 
   cout << "========= test LL(1) SymbolTable =========" << endl;
-  for (auto &nonterminal_pair : ll_table) {
-    auto &nonterminal = nonterminal_pair.first;
-    auto &jump_map = nonterminal_pair.second;
+  for (size_t i = 0; i < ll_table.nonterminal_num(); ++i) {
+    auto &nonterminal = grammar.nonterminals()[i];
 
     cout << "[Nonterminal] " << to_string(nonterminal) << endl;
-    for (auto &p : jump_map) {
-      auto &terminal = p.first;
-      auto rule_index = p.second;
+    for (size_t k = 0; k < ll_table.terminal_num(); ++k) {
+      auto &terminal = grammar.terminals()[k];
+      auto rule_index = ll_table.Get(i, k);
+      if (LLTable::kErrorRule == rule_index) {
+        continue;
+      }
 
       cout << "{" << to_string(terminal) << "->" << rule_index << "}" << " ";
     }
@@ -152,7 +157,66 @@ void TEST_Golike() {
   logger.log("Parse result {}", result);
 }
 
-int main() {
+void PrintBatchReport(const BatchReport &report) {
+  for (auto &file : report.files) {
+    logger.log("{} {}: {} bytes, {} tokens, {} ms on worker {}",
+               file.IsSucceed() ? "[OK]  " : "[FAIL]", file.path, file.bytes,
+               file.token_num, file.seconds * 1000, file.worker);
+  }
+  logger.log("{} files, {} failed, {} threads, {} ms",
+             report.files.size(), report.failed_num, report.thread_num,
+             report.seconds * 1000);
+  logger.log("throughput: {} MB/s, {} tokens/s",
+             report.BytesPerSecond() / (1024 * 1024),
+             report.TokensPerSecond());
+}
+
+/**
+ * @brief   compile golike source files: main [-j N] path...
+ */
+int CompileGolike(int argc, char *argv[]) {
+  using namespace golike_grammar;
+
+  size_t thread_num = 0;
+  vector<string> paths;
+  for (int i = 1; i < argc; ++i) {
+    if (0 == strcmp(argv[i], "-j") && i + 1 < argc) {
+      thread_num = strtoul(argv[++i], nullptr, 10);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  vector<string> files;
+  if (!CollectSourceFiles(paths, ".go", files)) {
+    return 1;
+  }
+
+  Grammar grammar = BuildGolikeGrammar();
+  LLTable ll_table;
+  if (!BuildLLTable(grammar, ll_table)) {
+    // build again for the diagnostics
+    LLTableReport table_report;
+    BuildLLTable(grammar, ll_table, &table_report);
+    PrintLLTableReport(std::cerr, grammar, table_report);
+    logger.error("Build LL(1) Table failed");
+    return 1;
+  }
+  Tokenizer tokenizer = BuildGolikeTokenizer();
+
+  BatchDriver driver(tokenizer, grammar, ll_table,
+                     [] { return CreateGolikeGrammarData(); });
+  BatchReport report = driver.Run(files, thread_num);
+  PrintBatchReport(report);
+
+  return 0 == report.failed_num ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) {
+    return CompileGolike(argc, argv);
+  }
+
   logger.set_log_level(kDebug);
 
   logger.log("sizeof Symbol::Type : {}", sizeof(Symbol::Type));
@@ -0,0 +1,300 @@
+//
+// Created by Dyinnz on 16-10-17.
+//
+
+#include "parser_gen.h"
+#include "simplelogger.h"
+
+#include <map>
+#include <set>
+
+using std::vector;
+using std::string;
+using std::ostream;
+
+extern simple_logger::BaseLogger logger;
+
+namespace {
+
+string FunctionName(size_t nonterminal) {
+  return "NonTerminal" + std::to_string(nonterminal);
+}
+
+string QuoteString(const string &s) {
+  string result = "\"";
+  for (char c : s) {
+    if ('\\' == c || '"' == c) {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result + '"';
+}
+
+bool IsLoopRule(const ProductionRule &rule) {
+  return !rule.right().empty() && rule.right().back() == rule.left();
+}
+
+/**
+ * @brief   the non-terminals reachable from the start symbol by the rules in
+ *          table, in the order of dense index
+ */
+vector<size_t> ReachableNonTerminals(const Grammar &grammar,
+                                     const LLTable &ll_table,
+                                     size_t start) {
+  vector<bool> is_reached(ll_table.nonterminal_num(), false);
+  vector<size_t> pending{start};
+  is_reached[start] = true;
+
+  while (!pending.empty()) {
+    size_t nonterminal = pending.back();
+    pending.pop_back();
+    for (size_t t = 0; t < ll_table.terminal_num(); ++t) {
+      auto rule_index = ll_table.Get(nonterminal, t);
+      if (LLTable::kErrorRule == rule_index) {
+        continue;
+      }
+      for (auto &symbol : grammar.GetRule(rule_index).right()) {
+        if (symbol.IsTerminal()) {
+          continue;
+        }
+        size_t next = grammar.SymbolIndex(symbol);
+        if (!is_reached[next]) {
+          is_reached[next] = true;
+          pending.push_back(next);
+        }
+      }
+    }
+  }
+
+  vector<size_t> result;
+  for (size_t i = 0; i < is_reached.size(); ++i) {
+    if (is_reached[i]) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+bool CheckSnippetNames(const Grammar &grammar, const LLTable &ll_table,
+                       const vector<size_t> &nonterminals) {
+  if (grammar.token_feeder_name().empty()) {
+    logger.error("{}(): the token feeder is not named", __func__);
+    return false;
+  }
+  for (size_t nonterminal : nonterminals) {
+    for (size_t t = 0; t < ll_table.terminal_num(); ++t) {
+      auto rule_index = ll_table.Get(nonterminal, t);
+      if (LLTable::kErrorRule != rule_index
+          && grammar.SnippetName(rule_index).empty()) {
+        logger.error("{}(): the snippet of rule {} is not named", __func__,
+                     grammar.GetRule(rule_index));
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief   parse the right part of a rule, the left symbol at the end of a
+ *          loop rule is left to the loop
+ */
+void EmitRule(ostream &os, const Grammar &grammar, size_t rule_index,
+              const char *indent) {
+  auto &rule = grammar.GetRule(rule_index);
+  bool is_loop = IsLoopRule(rule);
+  os << indent << "// " << rule << '\n';
+
+  auto &right = rule.right();
+  size_t right_num = is_loop ? right.size() - 1 : right.size();
+  for (size_t i = 0; i < right_num; ++i) {
+    auto &symbol = right[i];
+    if (symbol == kEpsilonSymbol) {
+      continue;
+    } else if (symbol.IsTerminal()) {
+      os << indent << "if (!Expect(ctx, " << symbol.ID() << ", "
+         << QuoteString(symbol.str()) << ")) return false;\n";
+    } else {
+      os << indent << "if (!" << FunctionName(grammar.SymbolIndex(symbol))
+         << "(ctx)) return false;\n";
+    }
+  }
+
+  if (is_loop) {
+    os << indent << "ctx.pending.push_back(" << rule_index << ");\n"
+       << indent << "continue;\n";
+  } else {
+    os << indent << grammar.SnippetName(rule_index)
+       << "(ctx.grammar_data);\n";
+  }
+}
+
+/**
+ * @brief   the cases are grouped by rule, a non-terminal with loop rules
+ *          switches in a loop
+ */
+void EmitNonTerminal(ostream &os, const Grammar &grammar,
+                     const LLTable &ll_table, size_t nonterminal) {
+  std::map<LLTable::RuleIndex, vector<size_t>> rule_to_terminals;
+  bool has_loop = false;
+  for (size_t t = 0; t < ll_table.terminal_num(); ++t) {
+    auto rule_index = ll_table.Get(nonterminal, t);
+    if (LLTable::kErrorRule != rule_index) {
+      rule_to_terminals[rule_index].push_back(t);
+      has_loop = has_loop || IsLoopRule(grammar.GetRule(rule_index));
+    }
+  }
+
+  auto &symbol = grammar.nonterminals()[nonterminal];
+  const char *indent = has_loop ? "        " : "      ";
+  const char *case_indent = has_loop ? "    " : "  ";
+
+  os << "// " << symbol << '\n'
+     << "bool " << FunctionName(nonterminal) << "(Context &ctx) {\n";
+  if (has_loop) {
+    os << "  size_t pending_num = ctx.pending.size();\n"
+       << "  while (true) {\n";
+  }
+  os << case_indent << "switch (ctx.token->symbol.ID()) {\n";
+
+  for (auto &pair : rule_to_terminals) {
+    for (size_t t : pair.second) {
+      auto &terminal = grammar.terminals()[t];
+      os << case_indent << "  case " << terminal.ID() << ":  // "
+         << terminal << '\n';
+    }
+    EmitRule(os, grammar, pair.first, indent);
+    if (!IsLoopRule(grammar.GetRule(pair.first))) {
+      os << indent << (has_loop ? "break;\n" : "return true;\n");
+    }
+  }
+  os << case_indent << "  default:\n"
+     << indent << "return Unexpected(ctx, " << QuoteString(symbol.str())
+     << ");\n"
+     << case_indent << "}\n";
+
+  if (has_loop) {
+    os << "    break;\n"
+       << "  }\n\n"
+       << "  // the snippets of loop rules are called from the innermost\n"
+       << "  while (ctx.pending.size() > pending_num) {\n"
+       << "    CallSnippet(ctx, ctx.pending.back());\n"
+       << "    ctx.pending.pop_back();\n"
+       << "  }\n"
+       << "  return true;\n";
+  }
+  os << "}\n\n";
+}
+
+void EmitCallSnippet(ostream &os, const Grammar &grammar,
+                     const LLTable &ll_table,
+                     const vector<size_t> &nonterminals) {
+  std::set<LLTable::RuleIndex> loop_rules;
+  for (size_t nonterminal : nonterminals) {
+    for (size_t t = 0; t < ll_table.terminal_num(); ++t) {
+      auto rule_index = ll_table.Get(nonterminal, t);
+      if (LLTable::kErrorRule != rule_index
+          && IsLoopRule(grammar.GetRule(rule_index))) {
+        loop_rules.insert(rule_index);
+      }
+    }
+  }
+
+  os << "void CallSnippet(Context &ctx, uint32_t rule_index) {\n"
+     << "  switch (rule_index) {\n";
+  for (auto rule_index : loop_rules) {
+    os << "    case " << rule_index << ": "
+       << grammar.SnippetName(rule_index) << "(ctx.grammar_data);\n"
+       << "      break;\n";
+  }
+  os << "    default:\n"
+     << "      break;\n"
+     << "  }\n"
+     << "}\n\n";
+}
+
+} // end of anonymous namespace
+
+bool GenerateParser(const Grammar &grammar,
+                    const LLTable &ll_table,
+                    const string &name,
+                    const string &header,
+                    const string &grammar_header,
+                    ostream &header_os,
+                    ostream &source_os) {
+  size_t start = grammar.SymbolIndex(kStartSymbol);
+  if (start >= ll_table.nonterminal_num()) {
+    logger.error("{}(): no start symbol in table", __func__);
+    return false;
+  }
+
+  auto nonterminals = ReachableNonTerminals(grammar, ll_table, start);
+  if (!CheckSnippetNames(grammar, ll_table, nonterminals)) {
+    return false;
+  }
+
+  header_os << "// Generated by parser_gen, do not edit.\n\n"
+            << "#pragma once\n\n"
+            << "#include <vector>\n\n"
+            << "#include \"token.h\"\n\n"
+            << "bool Parse" << name << "(void *grammar_data,"
+            << " std::vector<TokenView> &tokens);\n";
+
+  source_os << "// Generated by parser_gen, do not edit.\n\n"
+            << "#include \"" << header << "\"\n"
+            << "#include \"" << grammar_header << "\"\n"
+            << "#include \"simplelogger.h\"\n\n"
+            << "extern simple_logger::BaseLogger logger;\n\n"
+            << "namespace {\n\n"
+            << "struct Context {\n"
+            << "  void *grammar_data;\n"
+            << "  const TokenView *token;\n"
+            << "  std::vector<uint32_t> pending;\n"
+            << "};\n\n"
+            << "inline bool Expect(Context &ctx, int id, const char *name) {\n"
+            << "  if (ctx.token->symbol.ID() != id) {\n"
+            << "    logger.error(\"terminal mismatch: top state {}, "
+            << "candidate {}\",\n"
+            << "                 name, ctx.token->symbol);\n"
+            << "    return false;\n"
+            << "  }\n"
+            << "  " << grammar.token_feeder_name()
+            << "(ctx.grammar_data, *ctx.token);\n"
+            << "  ++ctx.token;\n"
+            << "  return true;\n"
+            << "}\n\n"
+            << "bool Unexpected(Context &ctx, const char *name) {\n"
+            << "  logger.error(\"wrong LL(1) Table: top symbol {}, "
+            << "no such {} in jump list\",\n"
+            << "               name, to_string(*ctx.token));\n"
+            << "  return false;\n"
+            << "}\n\n";
+
+  EmitCallSnippet(source_os, grammar, ll_table, nonterminals);
+
+  for (size_t nonterminal : nonterminals) {
+    source_os << "bool " << FunctionName(nonterminal) << "(Context &ctx);\n";
+  }
+  source_os << '\n';
+
+  for (size_t nonterminal : nonterminals) {
+    EmitNonTerminal(source_os, grammar, ll_table, nonterminal);
+  }
+
+  source_os << "} // end of anonymous namespace\n\n"
+            << "bool Parse" << name << "(void *grammar_data,"
+            << " std::vector<TokenView> &tokens) {\n"
+            << "  tokens.push_back(kEofToken.view());\n\n"
+            << "  Context ctx{grammar_data, tokens.data(), {}};\n"
+            << "  bool result = " << FunctionName(start) << "(ctx)\n"
+            << "      && ctx.token->symbol == kEofSymbol;\n\n"
+            << "  if (result) {\n"
+            << "    logger.debug(\"parsing finished, accept\");\n"
+            << "  } else {\n"
+            << "    logger.error(\"parsing finished, error\");\n"
+            << "  }\n"
+            << "  return result;\n"
+            << "}\n";
+  return true;
+}
@@ -0,0 +1,44 @@
+//
+// Created by Dyinnz on 16-10-17.
+//
+
+#pragma once
+
+#include <ostream>
+
+#include "grammar.h"
+#include "ll_parser.h"
+
+/**
+ * @brief   Generate C++ source of a recursive-descent parser from a grammar
+ *          and its LL(1) table, so that the parser needs neither the table nor
+ *          the std::function callbacks at runtime.
+ *
+ * @details Each non-terminal is a function switching on the symbol ID of the
+ *          lookahead token, the cases of which are the rules in the table.
+ *          The token feeder and snippets are called by their names, so all of
+ *          them should be named in the grammar. A rule ending with its left
+ *          symbol is parsed by a loop instead of recursion, and the snippets
+ *          of the loop are called from the innermost after it, in the same
+ *          order of LLParser. The generated source defines:
+ *
+ *          bool Parse<Name>(void *grammar_data,
+ *                           std::vector<TokenView> &tokens);
+ *            a EOF token is appended to tokens, returns whether accept.
+ *
+ * @param grammar           the grammar to be generated
+ * @param ll_table          the LL(1) table of grammar
+ * @param name              used in the name of generated function
+ * @param header            the name of generated header included by the source
+ * @param grammar_header    the header declaring the feeder and snippets
+ * @param header_os         output of the generated header
+ * @param source_os         output of the generated source
+ * @return                  whether succeed
+ */
+bool GenerateParser(const Grammar &grammar,
+                    const LLTable &ll_table,
+                    const std::string &name,
+                    const std::string &header,
+                    const std::string &grammar_header,
+                    std::ostream &header_os,
+                    std::ostream &source_os);
@@ -0,0 +1,60 @@
+//
+// Created by Dyinnz on 16-10-17.
+//
+
+#include <fstream>
+#include <iostream>
+
+#include "simplelogger.h"
+#include "parser_gen.h"
+#include "golike_grammar.h"
+
+using namespace std;
+using namespace simple_logger;
+
+BaseLogger logger;
+
+/**
+ * usage: parser_gen <golike> <name> <output path without suffix>
+ *
+ * only the golike grammar names its token feeder and snippets
+ */
+int main(int argc, char *argv[]) {
+  if (argc != 4) {
+    cerr << "usage: " << argv[0] << " <golike> <name> <output>" << endl;
+    return 1;
+  }
+
+  string grammar_name = argv[1];
+  Grammar grammar;
+  string grammar_header;
+  if ("golike" == grammar_name) {
+    grammar = golike_grammar::BuildGolikeGrammar();
+    grammar_header = "golike_grammar.h";
+  } else {
+    cerr << "unknown grammar " << grammar_name << endl;
+    return 1;
+  }
+
+  LLTable ll_table;
+  LLTableReport report;
+  if (!BuildLLTable(grammar, ll_table, &report)) {
+    PrintLLTableReport(cerr, grammar, report);
+    cerr << "could not build LL(1) table of " << grammar_name << endl;
+    return 1;
+  }
+
+  string output = argv[3];
+  string header = output + ".h";
+  ofstream header_os(header);
+  ofstream source_os(output + ".cc");
+
+  // the source includes the header in the same directory
+  string header_name = header.substr(header.find_last_of('/') + 1);
+  if (!GenerateParser(grammar, ll_table, argv[2], header_name, grammar_header,
+                      header_os, source_os)) {
+    cerr << "could not generate " << output << endl;
+    return 1;
+  }
+  return 0;
+}
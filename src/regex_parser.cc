@@ -36,6 +36,28 @@ shared_ptr<DFA> RegexParser::ParseToDFA(const std::string &s) {
   return ParseToDFA(s.c_str(), s.c_str() + s.length());
 }
 
+NFA *RegexParser::ParseToNFA(const char *beg, const char *end) {
+  beg_ = beg;
+  end_ = end;
+  return nfa_manager_->BuildNFA(ParseUnion(beg));
+}
+
+NFA *RegexParser::ParseToNFA(const std::string &s) {
+  return ParseToNFA(s.c_str(), s.c_str() + s.length());
+}
+
+shared_ptr<LazyDFA> RegexParser::ParseToLazyDFA(const char *beg,
+                                                const char *end,
+                                                size_t cache_budget) {
+  NFA *nfa = ParseToNFA(beg, end);
+  return std::make_shared<LazyDFA>(nfa, nfa_manager_, cache_budget);
+}
+
+shared_ptr<LazyDFA> RegexParser::ParseToLazyDFA(const std::string &s,
+                                                size_t cache_budget) {
+  return ParseToLazyDFA(s.c_str(), s.c_str() + s.length(), cache_budget);
+}
+
 NFAComponent *
 RegexParser::ParseToNFAComponent(const char *beg, const char *end) {
   beg_ = beg;
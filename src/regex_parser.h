@@ -40,6 +40,26 @@ class RegexParser {
 
   std::shared_ptr<DFA> ParseToDFA(const std::string &s);
 
+  /**
+   * @brief     construct NFA only, which could match without the DFA
+   *            conversion. The NFA is owned by the memory manager.
+   */
+  NFA *ParseToNFA(const char *beg, const char *end);
+
+  NFA *ParseToNFA(const std::string &s);
+
+  /**
+   * @brief     construct a lazy DFA, whose states are determinized on demand
+   * @param cache_budget    the max bytes of the cached DFA states
+   */
+  std::shared_ptr<LazyDFA> ParseToLazyDFA(
+      const char *beg, const char *end,
+      size_t cache_budget = LazyDFA::kDefaultCacheBudget);
+
+  std::shared_ptr<LazyDFA> ParseToLazyDFA(
+      const std::string &s,
+      size_t cache_budget = LazyDFA::kDefaultCacheBudget);
+
   /**
    * @brief     In order to build a tokenizer, should not construct DFA
    *            directly. Only construct a simple NFA compoment, let caller to
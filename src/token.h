@@ -4,10 +4,105 @@
 
 #pragma once
 
+#include <cstring>
 #include <string>
 #include <sstream>
 #include "symbol.h"
 
+/**
+ * @brief   A piece of text which does not own the memory, usually a slice of
+ *          the source text.
+ */
+class TextSlice {
+ public:
+  TextSlice() = default;
+
+  TextSlice(const char *data, size_t size) : data_(data), size_(size) {}
+
+  TextSlice(const char *str) : data_(str), size_(strlen(str)) {}
+
+  TextSlice(const std::string &s) : data_(s.data()), size_(s.size()) {}
+
+  const char *data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return 0 == size_;
+  }
+
+  const char *begin() const {
+    return data_;
+  }
+
+  const char *end() const {
+    return data_ + size_;
+  }
+
+  std::string str() const {
+    return std::string(data_, size_);
+  }
+
+  bool operator==(const TextSlice &rhs) const {
+    return size_ == rhs.size_ && 0 == memcmp(data_, rhs.data_, size_);
+  }
+
+  bool operator!=(const TextSlice &rhs) const {
+    return !operator==(rhs);
+  }
+
+ private:
+  const char *data_{""};
+  size_t size_{0};
+};
+
+inline std::ostream &operator<<(std::ostream &os, const TextSlice &slice) {
+  return os.write(slice.data(), slice.size());
+}
+
+struct Token;
+
+/**
+ * @brief   A token refers to the source text instead of copying it, so the
+ *          source text should outlive the token.
+ */
+struct TokenView {
+  TokenView(TextSlice text, const Symbol &symbol)
+      : text(text), symbol(symbol) {}
+
+  bool operator==(const TokenView &rhs) const {
+    return text == rhs.text && symbol == rhs.symbol;
+  }
+
+  bool operator!=(const TokenView &rhs) const {
+    return !operator==(rhs);
+  }
+
+  /**
+   * @return    a token owning a copy of the text
+   */
+  Token ToToken() const;
+
+  TextSlice text;
+  Symbol symbol;
+  size_t row{0};
+  size_t column{0};
+};
+
+/**
+ * @brief   The range of tokens replaced by an edit of source text, the tokens
+ *          before and after it are not changed.
+ */
+struct TokenEdit {
+  size_t first;
+  size_t removed_num;
+  size_t inserted_num;
+};
+
 /**
  * @brief   A token contains text extracted from source text, row and column
  *          number in source text.
@@ -16,6 +111,16 @@ struct Token {
   Token(std::string text, const Symbol &symbol)
       : text(std::move(text)), symbol(symbol) {}
 
+  /**
+   * @return    a view referring to the text of this token
+   */
+  TokenView view() const {
+    TokenView token_view(text, symbol);
+    token_view.row = row;
+    token_view.column = column;
+    return token_view;
+  }
+
   bool operator==(const Token &rhs) const {
     return text == rhs.text && symbol == rhs.symbol;
   }
@@ -36,6 +141,13 @@ struct Token {
 static const Token kErrorToken("kErrorToken", kErrorSymbol);
 static const Token kEofToken("kEofToken", kEofSymbol);
 
+inline Token TokenView::ToToken() const {
+  Token token(text.str(), symbol);
+  token.row = row;
+  token.column = column;
+  return token;
+}
+
 /**
  * @brief   A helper function for debugging
  */
@@ -45,3 +157,10 @@ inline std::string to_string(const Token &token) {
       << token.symbol << ", " << token.text << " }";
   return oss.str();
 }
+
+inline std::string to_string(const TokenView &token) {
+  std::ostringstream oss;
+  oss << "Token { P(" << token.row << ',' << token.column << "), "
+      << token.symbol << ", " << token.text << " }";
+  return oss.str();
+}
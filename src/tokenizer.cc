@@ -4,6 +4,17 @@
 #include "tokenizer.h"
 #include "simplelogger.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <unordered_set>
+
 using std::vector;
 using std::string;
 using std::move;
@@ -11,7 +22,131 @@ using std::pair;
 
 extern simple_logger::BaseLogger logger;
 
-bool Tokenizer::MatchString(const char *p, const std::string &str) {
+namespace {
+
+static_assert(sizeof(int) == sizeof(int32_t), "int should be 32 bits");
+
+constexpr char kImageMagic[8] = {'T', 'O', 'K', 'E', 'N', 'D', 'F', 'A'};
+constexpr uint32_t kImageVersion = 2;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr size_t kImageAlignment = 8;
+
+/**
+ * @brief   the layout of a saved tokenizer. All the offsets are relative to
+ *          the begin of file, so that it could be mapped anywhere.
+ */
+struct ImageHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t file_size;
+
+  int32_t start_state;
+  uint32_t state_num;
+  uint32_t class_num;
+  uint32_t byte_to_class;     // uint8_t[256]
+  uint32_t transitions;       // int32_t[state_num * class_num]
+  uint32_t priorities;        // int32_t[state_num]
+  uint32_t ends;              // uint8_t[state_num]
+
+  uint32_t symbol_num;        // the symbols indexed by priority
+  uint32_t ignore_num;        // the ignored symbols, following the above
+  uint32_t symbols;           // SymbolRecord[symbol_num + ignore_num]
+
+  uint32_t strings;           // '\0' terminated strings
+  uint32_t strings_size;
+  uint32_t line_comment_start;
+  uint32_t block_comment_start;
+  uint32_t block_comment_end;
+
+  uint32_t keyword_num;       // 0 if the keywords are matched by patterns
+  uint32_t keywords;          // KeywordRecord[keyword_num]
+  uint32_t keyword_seed;
+  uint32_t keyword_slot_num;
+  int32_t identifier_id;
+  uint32_t identifier_type;
+  uint32_t identifier_name;   // offset in strings
+};
+
+struct SymbolRecord {
+  int32_t id;
+  uint32_t type;
+  uint32_t name;              // offset in strings
+};
+
+struct KeywordRecord {
+  uint32_t text;              // offset in strings
+  SymbolRecord symbol;
+};
+
+class ImageWriter {
+ public:
+  ImageWriter() : image_(sizeof(ImageHeader), '\0') {}
+
+  /**
+   * @return    the offset of data
+   */
+  uint32_t Append(const void *data, size_t size) {
+    image_.resize((image_.size() + kImageAlignment - 1) / kImageAlignment
+                      * kImageAlignment, '\0');
+    uint32_t offset = image_.size();
+    image_.append(static_cast<const char *>(data), size);
+    return offset;
+  }
+
+  /**
+   * @return    the offset of string in the string table
+   */
+  uint32_t AddString(const char *str) {
+    uint32_t offset = strings_.size();
+    strings_.append(str);
+    strings_.push_back('\0');
+    return offset;
+  }
+
+  const string &strings() const {
+    return strings_;
+  }
+
+  string &image() {
+    return image_;
+  }
+
+ private:
+  string image_;
+  string strings_;
+};
+
+/**
+ * @return    whether the array lies in the image and is aligned
+ */
+bool IsValidSection(const ImageHeader &header, uint32_t offset,
+                    size_t count, size_t elem_size) {
+  return 0 == offset % kImageAlignment
+      && offset >= sizeof(ImageHeader)
+      && offset <= header.file_size
+      && count <= (header.file_size - offset) / elem_size;
+}
+
+/**
+ * @brief     The names of loaded symbols are interned for the whole process,
+ *            like the string literals of declared symbols, since the symbols
+ *            are copied into tokens and nodes outliving the tokenizer.
+ * @return    the interned copy of name, never freed
+ */
+const char *InternSymbolName(const char *name) {
+  static std::mutex mutex;
+  // the nodes of set are not moved, so the strings stay in place
+  static auto names = new std::unordered_set<string>;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return names->insert(name).first->c_str();
+}
+
+} // end of anonymous namespace
+
+bool TokenizerCursor::MatchString(const char *p,
+                                  const std::string &str) const {
   if (str.empty()) {
     return false;
   }
@@ -26,13 +161,13 @@ bool Tokenizer::MatchString(const char *p, const std::string &str) {
   return (p + i) <= end_ && i == str.size();
 }
 
-const char *Tokenizer::SkipComment(const char *p) {
-  if (MatchString(p, line_comment_start_)) {
-    p += line_comment_start_.size();
+const char *TokenizerCursor::SkipComment(const char *p) {
+  auto &line_comment_start = tokenizer_.line_comment_start_;
+  auto &block_comment_start = tokenizer_.block_comment_start_;
+  auto &block_comment_end = tokenizer_.block_comment_end_;
 
-    while (p < end_ && *p != '\n') {
-      p += 1;
-    }
+  if (MatchString(p, line_comment_start)) {
+    p = byte_scan::FindByte(p + line_comment_start.size(), end_, '\n');
     if (p < end_) {
       // get a LF
       curr_row_ += 1;
@@ -43,21 +178,29 @@ const char *Tokenizer::SkipComment(const char *p) {
       return p;
     }
 
-  } else if (MatchString(p, block_comment_start_)) {
-    p += block_comment_start_.size();
+  } else if (MatchString(p, block_comment_start)) {
+    p += block_comment_start.size();
 
-    while (p < end_ && !MatchString(p, block_comment_end_)) {
-      if (*p == '\n') {
-        // get a LF
-        curr_row_ += 1;
-        curr_row_pos_ = p + 1;
+    // jump between the candidates of end mark, counting the LFs skipped
+    const char *q = p;
+    while (true) {
+      q = byte_scan::FindByte(q, end_, block_comment_end[0]);
+      if (q >= end_ || MatchString(q, block_comment_end)) {
+        break;
       }
-      p += 1;
+      q += 1;
     }
-    if (p < end_) {
-      return p + block_comment_end_.size();
+
+    const char *last_lf = nullptr;
+    curr_row_ += byte_scan::CountByte(p, q, '\n', last_lf);
+    if (last_lf) {
+      curr_row_pos_ = last_lf + 1;
+    }
+
+    if (q < end_) {
+      return q + block_comment_end.size();
     } else {
-      return p;
+      return q;
     }
 
   } else {
@@ -65,33 +208,49 @@ const char *Tokenizer::SkipComment(const char *p) {
   }
 }
 
-Token Tokenizer::GetNextToken(const char *&p) {
+TokenView TokenizerCursor::GetNextToken(const char *&p) {
   assert(p < end_);
 
-  Token longest_token = kErrorToken;
+  TokenView longest_token(TextSlice(), kErrorSymbol);
+
+  const DFATable &table = *tokenizer_.token_table_;
+  auto &accelerated_states = tokenizer_.accelerated_states_;
+  int curr_state = table.start();
 
-  const DFANode *curr_node = token_dfa_->start();
+  // the end of the longest token accepted so far
+  const char *accepted_end = nullptr;
 
   const char *s = p;
   while (s != end_) {
-    const DFANode *next_node = curr_node->GetNextNode(*s);
-
-    if (next_node) {
-      curr_node = next_node;
-      s += 1;
-      // logger.debug("{}", to_string(*curr_node));
+    curr_state = table.GetNextState(curr_state, *s);
+    if (DFATable::kDeadState == curr_state) {
+      break;
+    }
 
-      if (curr_node->IsEnd()) {
-        int priority = curr_node->priority();
-        longest_token.symbol = priority_to_symbol_[priority];
-      }
+    s += 1;
+    auto &accelerated = accelerated_states[curr_state];
+    if (accelerated.is_accelerated) {
+      // stay in the state until a stop byte
+      s = byte_scan::FindAny(s, end_, accelerated.stops, accelerated.stop_num,
+                             accelerated.has_high_stops);
+    }
 
-    } else {
-      break;
+    if (table.IsEnd(curr_state)) {
+      longest_token.symbol =
+          tokenizer_.priority_to_symbol_[table.priority(curr_state)];
+      accepted_end = s;
     }
   }
 
-  longest_token.text = std::string(p, s);
+  // the byte on which the DFA is dead has been examined too
+  scan_end_ = std::max(scan_end_, static_cast<size_t>(s - beg_) + 1);
+
+  if (accepted_end) {
+    s = accepted_end;
+  }
+
+  longest_token.symbol = tokenizer_.Classify(longest_token.symbol, p, s - p);
+  longest_token.text = TextSlice(p, s - p);
   longest_token.row = curr_row_;
   longest_token.column = p - curr_row_pos_;
   p = s;
@@ -100,58 +259,555 @@ Token Tokenizer::GetNextToken(const char *&p) {
   return longest_token;
 }
 
-bool Tokenizer::LexicalAnalyze(const string &s, vector<Token> &tokens) {
+bool TokenizerCursor::LexStep(TokenView &token, bool &is_produced) {
+  auto &space_bytes = tokenizer_.space_bytes_;
+  while (true) {
+    const char *new_curr_ = SkipComment(curr_);
+    if (new_curr_ == curr_ && curr_ < end_ && tokenizer_.IsSpaceByte(*curr_)) {
+      // the run of spaces is the same with the ignored tokens lexed one by one
+      new_curr_ = byte_scan::SkipAny(curr_, end_, space_bytes.data(),
+                                     space_bytes.size());
+    }
+    if (new_curr_ == curr_) {
+      break;
+    }
+    curr_ = new_curr_;
+  }
+
+  if (curr_ >= end_) {
+    return true;
+  }
+
+  token_start_ = curr_;
+  token = GetNextToken(curr_);
+
+  // error
+  if (token.symbol == kErrorSymbol) {
+    return false;
+  }
+  // record line no.
+  if (token.symbol == kLFSymbol) {
+    curr_row_ += 1;
+    curr_row_pos_ = curr_;
+    token.text = TextSlice("\\n", 2);
+  }
+  // skip ignored token
+  auto &ignore_set = tokenizer_.ignore_set_;
+  if (ignore_set.end() == ignore_set.find(token.symbol)) {
+    if (!(token.symbol == kLFSymbol && last_symbol_ == kLFSymbol)) {
+      last_symbol_ = token.symbol;
+      is_produced = true;
+    }
+  }
+  return true;
+}
+
+void TokenizerCursor::LogLexingError() const {
+  logger.error("could not get next token at ({}, {})",
+               curr_row_,
+               curr_ - curr_row_pos_);
+}
+
+bool TokenizerCursor::LexicalAnalyze(vector<TokenView> &tokens) {
+  if (!tokens.empty()) {
+    last_symbol_ = tokens.back().symbol;
+  }
+
+  while (curr_ < end_) {
+    if (!LexStep(tokens)) {
+      LogLexingError();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool TokenizerCursor::Next(TokenView &token) {
+  TokenView next_token(TextSlice(), kErrorSymbol);
+  while (!is_error_ && curr_ < end_) {
+    bool is_produced = false;
+    if (!LexStep(next_token, is_produced)) {
+      LogLexingError();
+      is_error_ = true;
+      return false;
+    }
+    if (is_produced) {
+      token_num_ += 1;
+      token = next_token;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TokenizerCursor::LexChunk(const char *start, const char *stop,
+                               ChunkResult &result) {
+  curr_ = start;
+  curr_row_pos_ = start;
+  curr_row_ = 0;
+
+  result.boundaries.push_back(CurrentBoundary(result.tokens));
+  while (curr_ < stop) {
+    if (!LexStep(result.tokens)) {
+      result.is_error = true;
+      break;
+    }
+    result.boundaries.push_back(CurrentBoundary(result.tokens));
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+
+void Tokenizer::BuildFastPaths() {
+  const DFATable &table = *token_table_;
+  int start = table.start();
+
+  // a space byte leads to an ignored token, which could not be longer
+  space_bytes_.clear();
+  for (int b = 0; b < 256; ++b) {
+    char c = static_cast<char>(b);
+    int state = table.GetNextState(start, c);
+    if (DFATable::kDeadState == state || !table.IsEnd(state)
+        || ignore_set_.end() ==
+            ignore_set_.find(priority_to_symbol_[table.priority(state)])) {
+      continue;
+    }
+
+    bool is_space = true;
+    for (int next_b = 0; next_b < 256 && is_space; ++next_b) {
+      int next = table.GetNextState(state, static_cast<char>(next_b));
+      is_space = DFATable::kDeadState == next
+          || (next == state && table.GetNextState(start,
+                                                  static_cast<char>(next_b))
+              == state);
+    }
+    if (is_space) {
+      space_bytes_.push_back(c);
+    }
+  }
+
+  // the LFs should be counted, and the comments should be checked
+  auto is_conflicted = [this](char c) {
+    return '\n' == c
+        || (!line_comment_start_.empty() && line_comment_start_[0] == c)
+        || (!block_comment_start_.empty() && block_comment_start_[0] == c);
+  };
+  if (space_bytes_.size() > byte_scan::kMaxSetSize
+      || space_bytes_.end() != std::find_if(space_bytes_.begin(),
+                                            space_bytes_.end(),
+                                            is_conflicted)) {
+    space_bytes_.clear();
+  }
+
+  accelerated_states_.assign(table.size(), AcceleratedState());
+  for (size_t state = 0; state < table.size(); ++state) {
+    auto is_stop = [&table, state](int b) {
+      return static_cast<int>(state)
+          != table.GetNextState(state, static_cast<char>(b));
+    };
+
+    // the high bytes are usually all stops or none, such as [^"]
+    bool is_high_stop = true;
+    for (int b = 128; b < 256 && is_high_stop; ++b) {
+      is_high_stop = is_stop(b);
+    }
+
+    std::string stops;
+    for (int b = 0; b < (is_high_stop ? 128 : 256); ++b) {
+      if (is_stop(b)) {
+        stops.push_back(static_cast<char>(b));
+      }
+    }
+
+    if (stops.size() <= byte_scan::kMaxSetSize) {
+      auto &accelerated = accelerated_states_[state];
+      accelerated.is_accelerated = true;
+      accelerated.has_high_stops = is_high_stop;
+      accelerated.stop_num = static_cast<uint8_t>(stops.size());
+      std::copy(stops.begin(), stops.end(), accelerated.stops);
+    }
+  }
+}
+
+bool Tokenizer::LexicalAnalyze(const string &s,
+                               vector<TokenView> &tokens) const {
+  return LexicalAnalyze(s.c_str(), s.c_str() + s.length(), tokens);
+}
+
+bool Tokenizer::LexicalAnalyze(const string &s, vector<Token> &tokens) const {
   return LexicalAnalyze(s.c_str(), s.c_str() + s.length(), tokens);
 }
 
 bool Tokenizer::LexicalAnalyze(const char *beg,
                                const char *end,
-                               vector<Token> &tokens) {
-  assert(token_dfa_);
+                               vector<Token> &tokens) const {
+  vector<TokenView> token_views;
+  bool result = LexicalAnalyze(beg, end, token_views);
 
-  beg_ = beg;
-  end_ = end;
+  tokens.reserve(tokens.size() + token_views.size());
+  for (auto &token_view : token_views) {
+    tokens.push_back(token_view.ToToken());
+  }
+  return result;
+}
 
-  curr_row_ = 1;
-  curr_row_pos_ = beg_;
+bool Tokenizer::LexicalAnalyze(const char *beg,
+                               const char *end,
+                               vector<TokenView> &tokens) const {
+  TokenizerCursor cursor(*this, beg, end);
+  return cursor.LexicalAnalyze(tokens);
+}
 
-  curr_ = beg;
-  while (true) {
-    const char *new_curr_ = curr_;
-    do {
-      curr_ = new_curr_;
-      new_curr_ = SkipComment(curr_);
-    } while (curr_ != new_curr_);
+constexpr size_t Tokenizer::kMinChunkSize;
 
-    if (curr_ >= end_) break;
+bool Tokenizer::ParallelLexicalAnalyze(const char *beg,
+                                       const char *end,
+                                       vector<TokenView> &tokens,
+                                       size_t thread_num,
+                                       size_t min_chunk_size) const {
+  typedef TokenizerCursor::Boundary Boundary;
+  typedef TokenizerCursor::ChunkResult ChunkResult;
 
-    Token token = GetNextToken(curr_);
+  if (0 == thread_num) {
+    thread_num = std::max(1u, std::thread::hardware_concurrency());
+  }
+  size_t length = end - beg;
+  thread_num = std::min(thread_num,
+                        length / std::max<size_t>(min_chunk_size, 1));
+  if (thread_num <= 1) {
+    return LexicalAnalyze(beg, end, tokens);
+  }
 
-    // error
-    if (token.symbol == kErrorSymbol) {
-      logger.error("could not get next token at ({}, {})",
-                   curr_row_,
-                   curr_ - curr_row_pos_);
-      return false;
+  // guess the chunk starts after LFs, the first one is always right
+  vector<const char *> starts{beg};
+  for (size_t i = 1; i < thread_num; ++i) {
+    const char *p = std::max(beg + length * i / thread_num, starts.back());
+    p = std::find(p, end, '\n');
+    if (p == end) {
+      break;
     }
-    // record line no.
-    if (token.symbol == kLFSymbol) {
-      curr_row_ += 1;
-      curr_row_pos_ = curr_;
-      token.text = "\\n";
-    }
-    // skip ignored token
-    if (ignore_set_.end() == ignore_set_.find(token.symbol)) {
-      if (!(token.symbol == kLFSymbol && !tokens.empty()
-          && tokens.back().symbol == kLFSymbol)) {
-        tokens.push_back(move(token));
+    if (p + 1 > starts.back()) {
+      starts.push_back(p + 1);
+    }
+  }
+  starts.push_back(end);
+
+  size_t chunk_num = starts.size() - 1;
+  vector<ChunkResult> results(chunk_num);
+
+  // each thread lexes with its own cursor
+  vector<std::thread> threads;
+  for (size_t i = 1; i < chunk_num; ++i) {
+    threads.emplace_back([this, beg, end, &starts, &results, i] {
+      TokenizerCursor cursor(*this, beg, end);
+      cursor.LexChunk(starts[i], starts[i + 1], results[i]);
+    });
+  }
+
+  // lex the first chunk on this thread as the ground truth
+  TokenizerCursor cursor(*this, beg, end);
+  if (!tokens.empty()) {
+    cursor.last_symbol_ = tokens.back().symbol;
+  }
+  bool result = true;
+  while (cursor.curr_ < starts[1]) {
+    if (!cursor.LexStep(tokens)) {
+      result = false;
+      break;
+    }
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 1; i < chunk_num && result; ++i) {
+    auto &chunk = results[i];
+    auto &boundaries = chunk.boundaries;
+
+    while (true) {
+      auto iter = std::lower_bound(
+          boundaries.begin(), boundaries.end(), cursor.curr_,
+          [](const Boundary &b, const char *pos) { return b.pos < pos; });
+
+      if (boundaries.end() == iter || cursor.curr_ >= end) {
+        // the sequential lexing has passed the chunk
+        break;
+      }
+
+      if (iter->pos == cursor.curr_ && iter->row_pos == cursor.curr_row_pos_
+          && iter->is_after_lf == (kLFSymbol == cursor.last_symbol_)) {
+        // agree with the guessed lexing, adopt the rest of chunk
+        size_t row_delta = cursor.curr_row_ - iter->row;
+        for (size_t k = iter->token_num; k < chunk.tokens.size(); ++k) {
+          tokens.push_back(chunk.tokens[k]);
+          tokens.back().row += row_delta;
+        }
+
+        auto &last = boundaries.back();
+        cursor.curr_ = last.pos;
+        cursor.curr_row_pos_ = last.row_pos;
+        cursor.curr_row_ = last.row + row_delta;
+        cursor.last_symbol_ =
+            tokens.empty() ? kErrorSymbol : tokens.back().symbol;
+
+        if (chunk.is_error) {
+          // the error is right, lex it again to locate it
+          result = cursor.LexStep(tokens);
+        }
+        break;
+      }
+
+      // disagree, go on lexing sequentially
+      if (!cursor.LexStep(tokens)) {
+        result = false;
+        break;
       }
     }
   }
 
+  while (result && cursor.curr_ < end) {
+    result = cursor.LexStep(tokens);
+  }
+
+  if (!result) {
+    cursor.LogLexingError();
+  }
+  return result;
+}
+
+bool Tokenizer::Save(const std::string &path) const {
+  if (!token_table_) {
+    logger.error("{}(): the tokenizer has no table", __func__);
+    return false;
+  }
+
+  const DFATable &table = *token_table_;
+  ImageWriter writer;
+  ImageHeader header;
+  memset(&header, 0, sizeof(header));
+
+  memcpy(header.magic, kImageMagic, sizeof(header.magic));
+  header.version = kImageVersion;
+  header.byte_order = kByteOrderMark;
+
+  header.start_state = table.start();
+  header.state_num = table.size();
+  header.class_num = table.class_num();
+  header.byte_to_class =
+      writer.Append(table.byte_to_class(), CharClasses::kByteNum);
+  header.transitions = writer.Append(
+      table.transitions(), table.size() * table.class_num() * sizeof(int));
+  header.priorities =
+      writer.Append(table.priorities(), table.size() * sizeof(int));
+  header.ends = writer.Append(table.ends(), table.size());
+
+  vector<SymbolRecord> records;
+  for (auto &symbol : priority_to_symbol_) {
+    records.push_back({symbol.ID(), static_cast<uint32_t>(symbol.type()),
+                       writer.AddString(symbol.str())});
+  }
+  for (auto &symbol : ignore_set_) {
+    records.push_back({symbol.ID(), static_cast<uint32_t>(symbol.type()),
+                       writer.AddString(symbol.str())});
+  }
+  header.symbol_num = priority_to_symbol_.size();
+  header.ignore_num = ignore_set_.size();
+  header.symbols =
+      writer.Append(records.data(), records.size() * sizeof(SymbolRecord));
+
+  vector<KeywordRecord> keyword_records;
+  for (auto &keyword : keyword_table_.keywords()) {
+    auto &symbol = keyword.second;
+    keyword_records.push_back(
+        {writer.AddString(keyword.first.c_str()),
+         {symbol.ID(), static_cast<uint32_t>(symbol.type()),
+          writer.AddString(symbol.str())}});
+  }
+  header.keyword_num = keyword_records.size();
+  header.keywords = writer.Append(keyword_records.data(),
+                                  keyword_records.size()
+                                      * sizeof(KeywordRecord));
+  header.keyword_seed = keyword_table_.seed();
+  header.keyword_slot_num = keyword_table_.slot_num();
+  header.identifier_id = identifier_symbol_.ID();
+  header.identifier_type = static_cast<uint32_t>(identifier_symbol_.type());
+  header.identifier_name = writer.AddString(identifier_symbol_.str());
+
+  header.line_comment_start = writer.AddString(line_comment_start_.c_str());
+  header.block_comment_start = writer.AddString(block_comment_start_.c_str());
+  header.block_comment_end = writer.AddString(block_comment_end_.c_str());
+  header.strings_size = writer.strings().size();
+  header.strings = writer.Append(writer.strings().data(), header.strings_size);
+
+  string &image = writer.image();
+  header.file_size = image.size();
+  memcpy(&image[0], &header, sizeof(header));
+
+  std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+  if (!fout || !fout.write(image.data(), image.size())) {
+    logger.error("{}(): could not write {}", __func__, path);
+    return false;
+  }
   return true;
 }
 
+TokenizerBuilder &TokenizerBuilder::Load(const std::string &path) {
+  is_error_ = true;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (-1 == fd) {
+    logger.error("{}(): could not open {}", __func__, path);
+    return *this;
+  }
+
+  struct stat file_stat;
+  if (-1 == fstat(fd, &file_stat)
+      || file_stat.st_size < static_cast<off_t>(sizeof(ImageHeader))) {
+    logger.error("{}(): {} is not a tokenizer file", __func__, path);
+    close(fd);
+    return *this;
+  }
+
+  size_t file_size = file_stat.st_size;
+  void *addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == addr) {
+    logger.error("{}(): could not map {}", __func__, path);
+    return *this;
+  }
+
+  std::shared_ptr<const void> image(addr, [file_size](void *p) {
+    munmap(p, file_size);
+  });
+  const char *base = static_cast<const char *>(addr);
+  const ImageHeader &header = *static_cast<const ImageHeader *>(addr);
+
+  // check the header and the bounds of all sections
+  if (0 != memcmp(header.magic, kImageMagic, sizeof(header.magic))
+      || header.byte_order != kByteOrderMark
+      || header.file_size != file_size) {
+    logger.error("{}(): {} is not a tokenizer file", __func__, path);
+    return *this;
+  }
+  if (header.version != kImageVersion) {
+    logger.error("{}(): version {} of {} is not supported",
+                 __func__, header.version, path);
+    return *this;
+  }
+
+  size_t state_num = header.state_num;
+  size_t class_num = header.class_num;
+  size_t record_num = header.symbol_num + size_t(header.ignore_num);
+  if (class_num > CharClasses::kByteNum
+      || !IsValidSection(header, header.byte_to_class,
+                         CharClasses::kByteNum, 1)
+      || !IsValidSection(header, header.transitions,
+                         state_num * class_num, sizeof(int))
+      || !IsValidSection(header, header.priorities, state_num, sizeof(int))
+      || !IsValidSection(header, header.ends, state_num, 1)
+      || !IsValidSection(header, header.symbols,
+                         record_num, sizeof(SymbolRecord))
+      || !IsValidSection(header, header.keywords,
+                         header.keyword_num, sizeof(KeywordRecord))
+      || !IsValidSection(header, header.strings, header.strings_size, 1)
+      || 0 == header.strings_size
+      || '\0' != base[header.strings + header.strings_size - 1]) {
+    logger.error("{}(): {} is broken", __func__, path);
+    return *this;
+  }
+
+  auto byte_to_class =
+      reinterpret_cast<const uint8_t *>(base + header.byte_to_class);
+  auto transitions = reinterpret_cast<const int *>(base + header.transitions);
+  auto priorities = reinterpret_cast<const int *>(base + header.priorities);
+  auto ends = reinterpret_cast<const uint8_t *>(base + header.ends);
+  auto records = reinterpret_cast<const SymbolRecord *>(base + header.symbols);
+  auto keyword_records =
+      reinterpret_cast<const KeywordRecord *>(base + header.keywords);
+  const char *strings = base + header.strings;
+
+  // check the contents, so that tokenizing would never go out of bounds
+  bool is_valid = header.start_state >= 0
+      && static_cast<size_t>(header.start_state) < state_num
+      && header.line_comment_start < header.strings_size
+      && header.block_comment_start < header.strings_size
+      && header.block_comment_end < header.strings_size
+      && header.identifier_name < header.strings_size
+      && header.identifier_type <= Symbol::kNonTerminal;
+  for (size_t b = 0; is_valid && b < CharClasses::kByteNum; ++b) {
+    is_valid = byte_to_class[b] < class_num;
+  }
+  for (size_t i = 0; is_valid && i < state_num * class_num; ++i) {
+    is_valid = transitions[i] >= DFATable::kDeadState
+        && transitions[i] < static_cast<int>(state_num);
+  }
+  for (size_t i = 0; is_valid && i < state_num; ++i) {
+    is_valid = !ends[i] || (priorities[i] >= 0
+        && priorities[i] < static_cast<int>(header.symbol_num));
+  }
+  for (size_t i = 0; is_valid && i < record_num; ++i) {
+    is_valid = records[i].name < header.strings_size
+        && records[i].type <= Symbol::kNonTerminal;
+  }
+  for (size_t i = 0; is_valid && i < header.keyword_num; ++i) {
+    auto &record = keyword_records[i];
+    is_valid = record.text < header.strings_size
+        && record.symbol.name < header.strings_size
+        && record.symbol.type <= Symbol::kNonTerminal;
+  }
+  if (!is_valid) {
+    logger.error("{}(): {} is broken", __func__, path);
+    return *this;
+  }
+
+  auto to_symbol = [&](const SymbolRecord &record) {
+    return Symbol(static_cast<Symbol::Type>(record.type), record.id,
+                  InternSymbolName(strings + record.name));
+  };
+
+  tokenizer_.priority_to_symbol_.clear();
+  for (size_t i = 0; i < header.symbol_num; ++i) {
+    tokenizer_.priority_to_symbol_.push_back(to_symbol(records[i]));
+  }
+  tokenizer_.ignore_set_.clear();
+  for (size_t i = header.symbol_num; i < record_num; ++i) {
+    tokenizer_.ignore_set_.insert(to_symbol(records[i]));
+  }
+
+  tokenizer_.keyword_table_ = KeywordTable();
+  if (header.keyword_num > 0) {
+    vector<Keyword> keywords;
+    for (size_t i = 0; i < header.keyword_num; ++i) {
+      keywords.emplace_back(strings + keyword_records[i].text,
+                            to_symbol(keyword_records[i].symbol));
+    }
+    if (!tokenizer_.keyword_table_.Build(std::move(keywords),
+                                         header.keyword_seed,
+                                         header.keyword_slot_num)) {
+      logger.error("{}(): {} is broken", __func__, path);
+      return *this;
+    }
+  }
+  tokenizer_.identifier_symbol_ =
+      Symbol(static_cast<Symbol::Type>(header.identifier_type),
+             header.identifier_id, strings + header.identifier_name);
+
+  tokenizer_.line_comment_start_ = strings + header.line_comment_start;
+  tokenizer_.block_comment_start_ = strings + header.block_comment_start;
+  tokenizer_.block_comment_end_ = strings + header.block_comment_end;
+
+  tokenizer_.token_dfa_ = nullptr;
+  tokenizer_.token_table_ = std::make_shared<DFATable>(
+      state_num, header.start_state, class_num, byte_to_class, transitions,
+      priorities, ends, image);
+  tokenizer_.image_ = image;
+
+  is_error_ = false;
+  return *this;
+}
+
 TokenizerBuilder &
 TokenizerBuilder::SetPatterns(const std::vector<TokenPattern> &patterns) {
   ResetPriority();
@@ -202,13 +858,503 @@ TokenizerBuilder::SetPatterns(const std::vector<TokenPattern> &patterns) {
 
   tokenizer_.priority_to_symbol_ = std::move(priority_to_symbol);
   tokenizer_.token_dfa_ = min_dfa;
+  tokenizer_.token_table_ = min_dfa->table();
+
+  if (!tokenizer_.keyword_table_.empty() && !CheckKeywords()) {
+    is_error_ = true;
+  }
+  return *this;
+}
 
+TokenizerBuilder &TokenizerBuilder::SetKeywords(vector<Keyword> keywords,
+                                                const Symbol &identifier) {
+  if (!tokenizer_.keyword_table_.Build(std::move(keywords))) {
+    is_error_ = true;
+    return *this;
+  }
+  tokenizer_.identifier_symbol_ = identifier;
+
+  if (tokenizer_.token_table_ && !CheckKeywords()) {
+    is_error_ = true;
+  }
   return *this;
 }
 
+TokenizerBuilder &TokenizerBuilder::SetKeywords(vector<Keyword> keywords,
+                                                const Symbol &identifier,
+                                                uint32_t seed,
+                                                size_t slot_num) {
+  if (!tokenizer_.keyword_table_.Build(std::move(keywords), seed, slot_num)) {
+    is_error_ = true;
+    return *this;
+  }
+  tokenizer_.identifier_symbol_ = identifier;
+
+  if (tokenizer_.token_table_ && !CheckKeywords()) {
+    is_error_ = true;
+  }
+  return *this;
+}
+
+bool TokenizerBuilder::CheckKeywords() {
+  const DFATable &table = *tokenizer_.token_table_;
+  auto &priority_to_symbol = tokenizer_.priority_to_symbol_;
+
+  for (auto &keyword : tokenizer_.keyword_table_.keywords()) {
+    auto &text = keyword.first;
+    int state = table.start();
+    for (size_t i = 0; i < text.size() && DFATable::kDeadState != state; ++i) {
+      state = table.GetNextState(state, text[i]);
+    }
+
+    if (DFATable::kDeadState == state || !table.IsEnd(state)
+        || priority_to_symbol[table.priority(state)]
+            != tokenizer_.identifier_symbol_) {
+      logger.error("{}(): keyword {} is not lexed as {}", __func__, text,
+                   tokenizer_.identifier_symbol_.str());
+      return false;
+    }
+  }
+  return true;
+}
+
 Tokenizer TokenizerBuilder::Build() {
   if (tokenizer_.ignore_set_.empty()) {
     tokenizer_.ignore_set_.insert(kSpaceSymbol);
   }
+  if (tokenizer_.token_table_) {
+    tokenizer_.BuildFastPaths();
+  }
   return std::move(tokenizer_);
 }
+
+/*----------------------------------------------------------------------------*/
+
+constexpr size_t TokenStream::kDefaultChunkSize;
+
+TokenStream::TokenStream(const Tokenizer &tokenizer, int fd,
+                         size_t chunk_size)
+    : tokenizer_(tokenizer), fd_(fd), chunk_size_(chunk_size) {
+  assert(tokenizer.GetTokenTable() && chunk_size > 0);
+}
+
+TokenStream::TokenStream(const Tokenizer &tokenizer, std::istream &is,
+                         size_t chunk_size)
+    : tokenizer_(tokenizer), is_(&is), chunk_size_(chunk_size) {
+  assert(tokenizer.GetTokenTable() && chunk_size > 0);
+}
+
+bool TokenStream::ReadChunk() {
+  if (is_eof_) {
+    return false;
+  }
+
+  // discard the consumed data
+  if (pos_ > 0) {
+    std::copy(buffer_.begin() + pos_, buffer_.begin() + data_end_,
+              buffer_.begin());
+    base_offset_ += pos_;
+    data_end_ -= pos_;
+    pos_ = 0;
+  }
+  if (buffer_.size() < data_end_ + chunk_size_) {
+    buffer_.resize(data_end_ + chunk_size_);
+  }
+
+  ssize_t count = 0;
+  if (is_) {
+    is_->read(&buffer_[data_end_], chunk_size_);
+    count = is_->gcount();
+  } else {
+    do {
+      count = read(fd_, &buffer_[data_end_], chunk_size_);
+    } while (-1 == count && EINTR == errno);
+  }
+
+  if (count < 0) {
+    logger.error("{}(): could not read input", __func__);
+    is_error_ = true;
+    count = 0;
+  }
+  if (0 == count) {
+    is_eof_ = true;
+    return false;
+  }
+
+  data_end_ += count;
+  return true;
+}
+
+bool TokenStream::EnsureAvailable(size_t n) {
+  while (data_end_ - pos_ < n) {
+    if (!ReadChunk()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TokenStream::MatchString(const std::string &str) {
+  if (str.empty() || !EnsureAvailable(str.size())) {
+    return false;
+  }
+  return 0 == memcmp(&buffer_[pos_], str.data(), str.size());
+}
+
+bool TokenStream::SkipComment() {
+  auto &line_comment_start = tokenizer_.GetLineComment();
+  auto &block_comment_start = tokenizer_.GetBlockCommentStart();
+  auto &block_comment_end = tokenizer_.GetBlockCommentEnd();
+
+  if (MatchString(line_comment_start)) {
+    pos_ += line_comment_start.size();
+
+    while (EnsureAvailable(1)) {
+      if ('\n' == buffer_[pos_++]) {
+        // get a LF
+        NewLine(Offset(pos_));
+        break;
+      }
+    }
+    return true;
+
+  } else if (MatchString(block_comment_start)) {
+    pos_ += block_comment_start.size();
+
+    while (!MatchString(block_comment_end)) {
+      if (!EnsureAvailable(1)) {
+        // get EOF
+        return true;
+      }
+      if ('\n' == buffer_[pos_]) {
+        // get a LF
+        NewLine(Offset(pos_ + 1));
+      }
+      pos_ += 1;
+    }
+    pos_ += block_comment_end.size();
+    return true;
+
+  } else {
+    return false;
+  }
+}
+
+bool TokenStream::Next(TokenView &token) {
+  const DFATable &table = *tokenizer_.GetTokenTable();
+  auto &priority_to_symbol = tokenizer_.GetPrioritySymbols();
+  auto &ignore_set = tokenizer_.GetIgnoreSet();
+
+  while (!is_error_) {
+    while (SkipComment()) {}
+
+    if (!EnsureAvailable(1)) {
+      return false;
+    }
+
+    // the offsets are relative to pos_, which may be moved by reading
+    size_t accepted_length = 0;
+    Symbol symbol = kErrorSymbol;
+    int curr_state = table.start();
+
+    for (size_t i = 0; pos_ + i < data_end_ || EnsureAvailable(i + 1); ++i) {
+      curr_state = table.GetNextState(curr_state, buffer_[pos_ + i]);
+      if (DFATable::kDeadState == curr_state) {
+        break;
+      }
+      if (table.IsEnd(curr_state)) {
+        symbol = priority_to_symbol[table.priority(curr_state)];
+        accepted_length = i + 1;
+      }
+    }
+
+    // error
+    if (kErrorSymbol == symbol) {
+      logger.error("could not get next token at ({}, {})",
+                   curr_row_, Offset(pos_) - row_start_);
+      is_error_ = true;
+      return false;
+    }
+
+    symbol = tokenizer_.Classify(symbol, &buffer_[pos_], accepted_length);
+    token = TokenView(TextSlice(&buffer_[pos_], accepted_length), symbol);
+    token.row = curr_row_;
+    token.column = Offset(pos_) - row_start_;
+    pos_ += accepted_length;
+
+    // record line no.
+    if (kLFSymbol == symbol) {
+      NewLine(Offset(pos_));
+      token.text = TextSlice("\\n", 2);
+    }
+    // skip ignored token and repeated LF
+    if (ignore_set.end() == ignore_set.find(symbol)
+        && !(kLFSymbol == symbol && kLFSymbol == last_symbol_)) {
+      last_symbol_ = symbol;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*----------------------------------------------------------------------------*/
+
+bool TokenizedText::Lex(TokenizerCursor &cursor, size_t scan_end,
+                        vector<TokenView> &tokens, vector<TokenSpan> &spans,
+                        const std::function<bool(size_t, const Symbol &)>
+                        &is_aligned) {
+  // the comment marks are examined at the start of each token
+  size_t comment_lookahead = std::max(tokenizer_.line_comment_start_.size(),
+                                      tokenizer_.block_comment_start_.size());
+  const char *base = text_.data();
+
+  cursor.scan_end_ = 0;
+  while (cursor.curr_ < cursor.end_) {
+    size_t token_num = tokens.size();
+    if (!cursor.LexStep(tokens)) {
+      cursor.LogLexingError();
+      return false;
+    }
+    if (tokens.size() == token_num) {
+      continue;
+    }
+
+    size_t start = cursor.token_start_ - base;
+    size_t end = cursor.curr_ - base;
+    scan_end = std::max(scan_end, std::max(cursor.scan_end_,
+                                           start + comment_lookahead));
+    cursor.scan_end_ = 0;
+    spans.push_back({start, end, scan_end});
+
+    if (is_aligned(end, tokens.back().symbol)) {
+      break;
+    }
+  }
+  return true;
+}
+
+void TokenizedText::RestoreCursor(TokenizerCursor &cursor,
+                                  size_t index) const {
+  auto &token = tokens_[index];
+  auto span = Span(index);
+  size_t row = Row(index);
+  const char *base = text_.data();
+
+  cursor.curr_ = base + span.end;
+  if (kLFSymbol == token.symbol) {
+    cursor.curr_row_ = row + 1;
+    cursor.curr_row_pos_ = base + span.end;
+  } else {
+    cursor.curr_row_ = row;
+    cursor.curr_row_pos_ = base + span.start - token.column;
+  }
+  cursor.last_symbol_ = token.symbol;
+}
+
+TokenizedText::TokenSpan TokenizedText::Span(size_t index) const {
+  TokenSpan span = spans_[index];
+  if (index >= shift_begin_) {
+    span.start += offset_shift_;
+    span.end += offset_shift_;
+    span.scan_end += offset_shift_;
+  }
+  return span;
+}
+
+void TokenizedText::ShiftToken(size_t index, size_t offset_shift,
+                               size_t row_shift) const {
+  auto &span = spans_[index];
+  span.start += offset_shift;
+  span.end += offset_shift;
+  span.scan_end += offset_shift;
+  tokens_[index].row += row_shift;
+}
+
+void TokenizedText::MoveShiftBegin(size_t index) {
+  if (0 == offset_shift_ && 0 == row_shift_) {
+    shift_begin_ = index;
+    return;
+  }
+  for (; shift_begin_ < index; ++shift_begin_) {
+    ShiftToken(shift_begin_, offset_shift_, row_shift_);
+  }
+  while (shift_begin_ > index) {
+    shift_begin_ -= 1;
+    ShiftToken(shift_begin_, -offset_shift_, -row_shift_);
+  }
+}
+
+void TokenizedText::Flush() const {
+  for (size_t i = shift_begin_; i < tokens_.size(); ++i) {
+    ShiftToken(i, offset_shift_, row_shift_);
+  }
+  shift_begin_ = tokens_.size();
+  offset_shift_ = 0;
+  row_shift_ = 0;
+
+  const char *base = text_.data();
+  for (size_t i = stale_begin_; i < tokens_.size(); ++i) {
+    if (kLFSymbol != tokens_[i].symbol) {
+      tokens_[i].text = TextSlice(base + spans_[i].start,
+                                  spans_[i].end - spans_[i].start);
+    }
+  }
+  stale_begin_ = tokens_.size();
+}
+
+bool TokenizedText::Assign(std::string text) {
+  text_ = std::move(text);
+  tokens_.clear();
+  spans_.clear();
+
+  TokenizerCursor cursor(tokenizer_, text_.data(),
+                         text_.data() + text_.size());
+  is_error_ = !Lex(cursor, 0, tokens_, spans_,
+                   [](size_t, const Symbol &) { return false; });
+
+  shift_begin_ = tokens_.size();
+  offset_shift_ = 0;
+  row_shift_ = 0;
+  stale_begin_ = tokens_.size();
+
+  last_edit_ = {0, 0, tokens_.size()};
+  return !is_error_;
+}
+
+bool TokenizedText::Edit(size_t offset, size_t removed_size,
+                         const std::string &inserted) {
+  if (offset > text_.size() || removed_size > text_.size() - offset) {
+    logger.error("{}(): the edit ({}, {}) is out of text", __func__,
+                 offset, removed_size);
+    return false;
+  }
+
+  if (is_error_) {
+    // the tokens after the error are unknown
+    string text = text_;
+    text.replace(offset, removed_size, inserted);
+    size_t removed_num = tokens_.size();
+    bool result = Assign(std::move(text));
+    last_edit_.removed_num = removed_num;
+    return result;
+  }
+
+  size_t edit_end = offset + removed_size;
+  size_t inserted_size = inserted.size();
+
+  // the first token examined the edited bytes, the ones before are kept
+  size_t first = 0;
+  size_t last = spans_.size();
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    if (Span(middle).scan_end <= offset) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+
+  const char *old_base = text_.data();
+  text_.replace(offset, removed_size, inserted);
+  const char *base = text_.data();
+  if (base != old_base) {
+    // the text is moved, so all the slices are rebuilt on reading
+    stale_begin_ = 0;
+  }
+
+  TokenizerCursor cursor(tokenizer_, base, base + text_.size());
+  if (first > 0) {
+    RestoreCursor(cursor, first - 1);
+  }
+
+  // an old boundary after the edit is moved to the same position, and the
+  // symbols before it are the same
+  size_t aligned = first;
+  bool is_aligned = false;
+  auto align = [&](size_t end, const Symbol &symbol) {
+    while (aligned < spans_.size()
+        && (Span(aligned).end < edit_end
+            || Span(aligned).end + inserted_size < end + removed_size)) {
+      aligned += 1;
+    }
+    is_aligned = aligned < spans_.size()
+        && Span(aligned).end + inserted_size == end + removed_size
+        && tokens_[aligned].symbol == symbol;
+    return is_aligned;
+  };
+
+  vector<TokenView> new_tokens;
+  vector<TokenSpan> new_spans;
+  size_t scan_end = 0 == first ? 0 : Span(first - 1).scan_end;
+  bool result = Lex(cursor, scan_end, new_tokens, new_spans, align);
+
+  size_t kept_begin = is_aligned ? aligned + 1 : tokens_.size();
+  if (!result) {
+    // the tokens after the error are dropped
+    kept_begin = tokens_.size();
+  }
+
+  // the rows and columns of kept tokens are moved with the aligned state
+  long row_delta = 0;
+  if (result && is_aligned) {
+    // the row start of aligned token is not changed by text_.replace()
+    auto &token = tokens_[aligned];
+    auto span = Span(aligned);
+    size_t old_row = Row(aligned);
+    size_t old_row_pos = span.start - token.column;
+    if (kLFSymbol == token.symbol) {
+      old_row += 1;
+      old_row_pos = span.end;
+    }
+
+    row_delta = static_cast<long>(cursor.curr_row_)
+        - static_cast<long>(old_row);
+    long column_delta = static_cast<long>(old_row_pos + inserted_size)
+        - static_cast<long>(removed_size)
+        - static_cast<long>(cursor.curr_row_pos_ - base);
+
+    // only the kept tokens on the aligned row have their columns moved
+    for (size_t i = kept_begin; i < tokens_.size() && Row(i) == old_row;
+         ++i) {
+      tokens_[i].column += column_delta;
+    }
+  }
+
+  // the pending shift covers exactly the kept tokens, then it is added by
+  // this edit, so the kept tokens are not visited
+  MoveShiftBegin(kept_begin);
+  offset_shift_ += inserted_size - removed_size;
+  row_shift_ += row_delta;
+
+  // the scan ends are the maximum ones before, which are raised by the new
+  // tokens until a kept one is greater
+  if (!new_spans.empty()) {
+    scan_end = new_spans.back().scan_end;
+  }
+  for (size_t i = kept_begin;
+       i < spans_.size() && Span(i).scan_end < scan_end; ++i) {
+    spans_[i].scan_end = scan_end - offset_shift_;
+  }
+
+  last_edit_ = {first, kept_begin - first, new_tokens.size()};
+
+  tokens_.erase(tokens_.begin() + first, tokens_.begin() + kept_begin);
+  tokens_.insert(tokens_.begin() + first, new_tokens.begin(), new_tokens.end());
+  spans_.erase(spans_.begin() + first, spans_.begin() + kept_begin);
+  spans_.insert(spans_.begin() + first, new_spans.begin(), new_spans.end());
+
+  // the indices after the replaced tokens are moved
+  size_t new_kept_begin = first + new_tokens.size();
+  shift_begin_ = new_kept_begin;
+  if (stale_begin_ > first) {
+    stale_begin_ = std::max(stale_begin_, kept_begin) - kept_begin
+        + new_kept_begin;
+  }
+  if (inserted_size != removed_size) {
+    stale_begin_ = std::min(stale_begin_, new_kept_begin);
+  }
+
+  is_error_ = !result;
+  return result;
+}
@@ -4,7 +4,13 @@
 
 #pragma once
 
+#include <functional>
+#include <istream>
+#include <thread>
+
+#include "byte_scan.h"
 #include "finite_automaton.h"
+#include "keyword_table.h"
 #include "regex_parser.h"
 
 using namespace regular_expression;
@@ -19,66 +25,183 @@ typedef std::pair<std::string, Symbol> TokenPattern;
  * @details The tokenizer could be builded by some token pattern using
  *          regular expression. The earlier patterns have higher priority.
  *
+ *          The tokenizer is immutable after built, and the lexing state is
+ *          kept by TokenizerCursor. So one tokenizer could be shared by many
+ *          threads lexing at the same time, without locking.
+ *
  *          The tokenizer should only be created by TokenizerBuilder instead of
  *          creating directly.
  */
 class Tokenizer {
  public:
   /**
-   * @return the DFA inside used to match token
+   * @return the DFA inside used to match token, nullptr if the tokenizer is
+   *         loaded from file or built from a compiled table
    */
   const DFA *GetTokenDFA() const {
-    return &*token_dfa_;
+    return token_dfa_.get();
   }
 
-  const char *CurrentPos() {
-    return curr_;
+  /**
+   * @return the transition table compiled from the DFA, used to match token
+   */
+  const DFATable *GetTokenTable() const {
+    return token_table_.get();
   }
 
   /**
-   * @brief     Extracted next token on current position
-   * @param p   current text position
-   * @return    the token following current position
+   * @return the symbols indexed by the priorities of patterns
+   */
+  const std::vector<Symbol> &GetPrioritySymbols() const {
+    return priority_to_symbol_;
+  }
+
+  const std::unordered_set<Symbol> &GetIgnoreSet() const {
+    return ignore_set_;
+  }
+
+  const std::string &GetLineComment() const {
+    return line_comment_start_;
+  }
+
+  const std::string &GetBlockCommentStart() const {
+    return block_comment_start_;
+  }
+
+  const std::string &GetBlockCommentEnd() const {
+    return block_comment_end_;
+  }
+
+  /**
+   * @return    the keywords classified from the identifiers, empty if the
+   *            keywords are matched by patterns
+   */
+  const KeywordTable &GetKeywordTable() const {
+    return keyword_table_;
+  }
+
+  const Symbol &GetIdentifierSymbol() const {
+    return identifier_symbol_;
+  }
+
+  /**
+   * @brief         classify a word matched by DFA
+   * @param symbol  the symbol matched
+   * @return        the symbol of keyword if the word is an identifier as well
+   *                as a keyword, otherwise the symbol matched
    */
-  Token GetNextToken(const char *&p);
+  const Symbol &Classify(const Symbol &symbol,
+                         const char *p, size_t size) const {
+    if (symbol == identifier_symbol_) {
+      if (auto keyword = keyword_table_.Find(p, size)) {
+        return *keyword;
+      }
+    }
+    return symbol;
+  }
 
   /**
+   * @brief         the tokens refer to the source text without copying, so
+   *                the text should outlive them
    * @param s       the source text
    * @param tokens  the tokens extracted
    * @return        whether succeed
    */
   bool LexicalAnalyze(const std::string &s,
-                      std::vector<Token> &tokens);
+                      std::vector<TokenView> &tokens) const;
+
+  /**
+   * @brief         the views into a temporary text would dangle
+   */
+  bool LexicalAnalyze(std::string &&s,
+                      std::vector<TokenView> &tokens) const = delete;
 
   /**
    * @param beg     the begin position of source text
    * @param end     the end position of source text
+   * @param tokens  the tokens extracted, referring to the source text
+   * @return        whether succeed
+   */
+  bool LexicalAnalyze(const char *beg,
+                      const char *end,
+                      std::vector<TokenView> &tokens) const;
+
+  /**
+   * @brief         the tokens own copies of their text
+   * @param s       the source text
    * @param tokens  the tokens extracted
    * @return        whether succeed
    */
+  bool LexicalAnalyze(const std::string &s,
+                      std::vector<Token> &tokens) const;
+
   bool LexicalAnalyze(const char *beg,
                       const char *end,
-                      std::vector<Token> &tokens);
+                      std::vector<Token> &tokens) const;
+
+  /**
+   * @brief         Split the text into chunks after LFs, and lex each chunk
+   *                on its own thread from the guessed start. Then the chunks
+   *                are stitched at the first position where the sequential
+   *                lexing agrees with the guessed one. The result is the same
+   *                with LexicalAnalyze().
+   * @param beg             the begin position of source text
+   * @param end             the end position of source text
+   * @param tokens          the tokens extracted, referring to the source text
+   * @param thread_num      the number of threads, 0 for hardware concurrency
+   * @param min_chunk_size  the text is not split into smaller chunks
+   * @return                whether succeed
+   */
+  bool ParallelLexicalAnalyze(const char *beg,
+                              const char *end,
+                              std::vector<TokenView> &tokens,
+                              size_t thread_num = 0,
+                              size_t min_chunk_size = kMinChunkSize) const;
+
+  constexpr static size_t kMinChunkSize{64 * 1024};
+
+  /**
+   * @brief         save the compiled tokenizer to a binary file, which could
+   *                be loaded by TokenizerBuilder::Load()
+   * @param path    the path of file
+   * @return        whether succeed
+   */
+  bool Save(const std::string &path) const;
 
  private:
   friend class TokenizerBuilder;
+  friend class TokenizerCursor;
+  friend class TokenizedText;
 
   /**
-   * @brief         Auxiliary function, used to match the mark of comment
-   * @param p       current position
-   * @param str     string to be matched
-   * @return        whether match
+   * @brief     a state looping to itself on all the bytes except a few stops,
+   *            such as the body of string literal
    */
-  bool MatchString(const char *p, const std::string &str);
+  struct AcceleratedState {
+    bool is_accelerated{false};
+    bool has_high_stops{false};
+    uint8_t stop_num{0};
+    char stops[byte_scan::kMaxSetSize];
+  };
 
   /**
-   * @param p   current position
-   * @return    skip the liine and block comments
+   * @brief     find the fast paths in the table, called after built
    */
-  const char *SkipComment(const char *p);
+  void BuildFastPaths();
+
+  bool IsSpaceByte(char c) const {
+    return byte_scan::detail::InSet(c, space_bytes_.data(),
+                                    space_bytes_.size());
+  }
 
  private:
   std::shared_ptr<DFA> token_dfa_;
+  std::shared_ptr<const DFATable> token_table_;
+
+  /**
+   * @brief     the mapped file, if the tokenizer is loaded from file
+   */
+  std::shared_ptr<const void> image_;
   std::vector<Symbol> priority_to_symbol_;
   std::unordered_set<Symbol> ignore_set_;
 
@@ -89,6 +212,147 @@ class Tokenizer {
   std::string block_comment_start_;
   std::string block_comment_end_;
 
+  /**
+   * @brief     fast paths, the runs of space bytes are ignored tokens, and
+   *            the accelerated states are indexed by state
+   */
+  std::string space_bytes_;
+  std::vector<AcceleratedState> accelerated_states_;
+
+  KeywordTable keyword_table_;
+  Symbol identifier_symbol_;
+};
+
+/**
+ * @brief   The lexing state of one scan over a source text.
+ *
+ * @details The cursor only refers to the tokenizer, so it is cheap to create.
+ *          Each thread should lex with its own cursor.
+ */
+class TokenizerCursor {
+ public:
+  /**
+   * @param tokenizer   should outlive the cursor
+   * @param beg         the begin position of source text
+   * @param end         the end position of source text
+   */
+  TokenizerCursor(const Tokenizer &tokenizer, const char *beg, const char *end)
+      : tokenizer_(tokenizer), beg_(beg), end_(end), curr_(beg),
+        curr_row_pos_(beg) {
+    assert(tokenizer.token_table_);
+  }
+
+  const char *CurrentPos() const {
+    return curr_;
+  }
+
+  /**
+   * @brief     Extracted next token on current position
+   * @param p   current text position
+   * @return    the token following current position
+   */
+  TokenView GetNextToken(const char *&p);
+
+  /**
+   * @brief         lex from current position to the end of text
+   * @param tokens  the tokens extracted are appended
+   * @return        whether succeed
+   */
+  bool LexicalAnalyze(std::vector<TokenView> &tokens);
+
+  /**
+   * @brief         lex on demand, the tokens are the same with
+   *                LexicalAnalyze()
+   * @param token   the next token not ignored, unchanged if returning false
+   * @return        false if reaching the end of text or an error occurs
+   */
+  bool Next(TokenView &token);
+
+  bool IsError() const {
+    return is_error_;
+  }
+
+  /**
+   * @return    the number of tokens pulled by Next()
+   */
+  size_t token_num() const {
+    return token_num_;
+  }
+
+ private:
+  friend class Tokenizer;
+  friend class TokenizedText;
+
+  /**
+   * @brief         Auxiliary function, used to match the mark of comment
+   * @param p       current position
+   * @param str     string to be matched
+   * @return        whether match
+   */
+  bool MatchString(const char *p, const std::string &str) const;
+
+  /**
+   * @param p   current position
+   * @return    skip the liine and block comments
+   */
+  const char *SkipComment(const char *p);
+
+  /**
+   * @brief     the lexing state between two tokens, the lexing from the same
+   *            state produces the same tokens
+   */
+  struct Boundary {
+    const char *pos;
+    const char *row_pos;
+    size_t row;
+    bool is_after_lf;
+    size_t token_num;
+  };
+
+  /**
+   * @brief     the tokens lexed from a guessed start
+   */
+  struct ChunkResult {
+    std::vector<TokenView> tokens;
+    std::vector<Boundary> boundaries;
+    bool is_error{false};
+  };
+
+  /**
+   * @brief     skip the comments and extract a token from current position
+   * @param is_produced     false if the token is ignored, or no token before
+   *                        the end of text
+   * @return    false if could not get a token
+   */
+  bool LexStep(TokenView &token, bool &is_produced);
+
+  bool LexStep(std::vector<TokenView> &tokens) {
+    TokenView token(TextSlice(), kErrorSymbol);
+    bool is_produced = false;
+    if (!LexStep(token, is_produced)) {
+      return false;
+    }
+    if (is_produced) {
+      tokens.push_back(token);
+    }
+    return true;
+  }
+
+  Boundary CurrentBoundary(const std::vector<TokenView> &tokens) const {
+    return {curr_, curr_row_pos_, curr_row_, kLFSymbol == last_symbol_,
+            tokens.size()};
+  }
+
+  void LogLexingError() const;
+
+  /**
+   * @brief     lex from start until passing stop, record all the boundaries
+   */
+  void LexChunk(const char *start, const char *stop, ChunkResult &result);
+
+ private:
+  const Tokenizer &tokenizer_;
+
   /**
    * @brief     position information
    */
@@ -96,7 +360,19 @@ class Tokenizer {
   const char *end_;
   const char *curr_;
   const char *curr_row_pos_;
-  size_t curr_row_;
+  size_t curr_row_{1};
+  Symbol last_symbol_{kErrorSymbol};
+
+  /**
+   * @brief     the start of last token matched, and the end of bytes examined
+   *            by DFA as an offset, which is the size plus 1 if the end of
+   *            text is examined
+   */
+  const char *token_start_{nullptr};
+  size_t scan_end_{0};
+
+  bool is_error_{false};
+  size_t token_num_{0};
 };
 
 /**
@@ -136,6 +412,51 @@ class TokenizerBuilder {
     return *this;
   }
 
+  /**
+   * @brief     Lex the keywords by the identifier pattern, then classify them
+   *            by a perfect hash, so that the keywords need no patterns and
+   *            the DFA is much smaller. Each keyword should be matched by the
+   *            identifier pattern as a whole.
+   * @param keywords    the keywords and their symbols
+   * @param identifier  the symbol of identifier pattern
+   * @return            this
+   */
+  TokenizerBuilder &SetKeywords(std::vector<Keyword> keywords,
+                                const Symbol &identifier);
+
+  /**
+   * @brief     use the seed of a perfect hash found before, such as the one
+   *            generated by GenerateTokenizer()
+   */
+  TokenizerBuilder &SetKeywords(std::vector<Keyword> keywords,
+                                const Symbol &identifier,
+                                uint32_t seed, size_t slot_num);
+
+  /**
+   * @brief     use a compiled table instead of setting the patterns, such as
+   *            the one generated by GenerateTokenizer()
+   * @param table               the transition table
+   * @param priority_to_symbol  the symbols indexed by priority
+   * @return                    this
+   */
+  TokenizerBuilder &SetTable(std::shared_ptr<const DFATable> table,
+                             std::vector<Symbol> priority_to_symbol) {
+    tokenizer_.token_dfa_ = nullptr;
+    tokenizer_.token_table_ = std::move(table);
+    tokenizer_.priority_to_symbol_ = std::move(priority_to_symbol);
+    return *this;
+  }
+
+  /**
+   * @brief         map a tokenizer saved by Tokenizer::Save(), instead of
+   *                setting the patterns. The tables are read from the mapped
+   *                file, which is kept alive by the tokenizer, and the names
+   *                of symbols are copied, which live as long as the process.
+   * @param path    the path of file
+   * @return        this
+   */
+  TokenizerBuilder &Load(const std::string &path);
+
   /**
    * @brief     After calling this function, you should not call others.
    *            Because all the data has been moved.
@@ -143,6 +464,11 @@ class TokenizerBuilder {
   Tokenizer Build();
 
  private:
+  /**
+   * @brief     check that each keyword is lexed as an identifier
+   */
+  bool CheckKeywords();
+
   void ResetPriority() {
     priority_index_ = 0;
   }
@@ -157,3 +483,234 @@ class TokenizerBuilder {
   bool is_error_{false};
 };
 
+
+/**
+ * @brief   Pull tokens one by one from an input read in chunks, instead of
+ *          reading the whole source into memory.
+ *
+ * @details Only the unconsumed input is buffered, so the memory is bounded by
+ *          the chunk size and the longest token. The tokens and comments
+ *          crossing the chunk boundaries are handled by reading more input.
+ *          The tokens are the same with Tokenizer::LexicalAnalyze().
+ */
+class TokenStream {
+ public:
+  constexpr static size_t kDefaultChunkSize{64 * 1024};
+
+  /**
+   * @param tokenizer   should outlive the stream
+   * @param fd          the file descriptor to be read, not closed by stream
+   * @param chunk_size  the bytes read once
+   */
+  TokenStream(const Tokenizer &tokenizer, int fd,
+              size_t chunk_size = kDefaultChunkSize);
+
+  /**
+   * @param tokenizer   should outlive the stream
+   * @param is          the input stream to be read
+   * @param chunk_size  the bytes read once
+   */
+  TokenStream(const Tokenizer &tokenizer, std::istream &is,
+              size_t chunk_size = kDefaultChunkSize);
+
+  /**
+   * @param token   the next token, whose text is valid until the next call
+   * @return        false if reaching the end of input or an error occurs
+   */
+  bool Next(TokenView &token);
+
+  bool IsError() const {
+    return is_error_;
+  }
+
+ private:
+  /**
+   * @brief     make n bytes available from the current position
+   * @return    whether the n bytes are available, false if reaching EOF
+   */
+  bool EnsureAvailable(size_t n);
+
+  /**
+   * @brief     read a chunk after the buffered data, the consumed data is
+   *            discarded at first
+   * @return    whether any byte is read
+   */
+  bool ReadChunk();
+
+  bool MatchString(const std::string &str);
+
+  /**
+   * @return    whether a comment is skipped
+   */
+  bool SkipComment();
+
+  void NewLine(size_t row_start) {
+    curr_row_ += 1;
+    row_start_ = row_start;
+  }
+
+  size_t Offset(size_t index) const {
+    return base_offset_ + index;
+  }
+
+ private:
+  const Tokenizer &tokenizer_;
+  int fd_{-1};
+  std::istream *is_{nullptr};
+  const size_t chunk_size_;
+
+  /**
+   * @brief     buffer_[pos_, data_end_) is the unconsumed input, and
+   *            base_offset_ is the offset of buffer_[0] in the whole input
+   */
+  std::vector<char> buffer_;
+  size_t pos_{0};
+  size_t data_end_{0};
+  size_t base_offset_{0};
+  bool is_eof_{false};
+  bool is_error_{false};
+
+  /**
+   * @brief     position information, the offset of row start is in the
+   *            whole input
+   */
+  size_t curr_row_{1};
+  size_t row_start_{0};
+  Symbol last_symbol_{kErrorSymbol};
+};
+
+/**
+ * @brief   A text and its tokens, which are updated incrementally by edits,
+ *          such as the buffer of an editor.
+ *
+ * @details Each token records the end of bytes examined when lexing it. An
+ *          edit is re-lexed from the end of the last token which did not
+ *          examine the edited bytes, until a token ends at an old boundary
+ *          after the edit. The tokens after it are kept, and only their
+ *          positions are moved. The tokens are the same with lexing the whole
+ *          edited text by Tokenizer::LexicalAnalyze().
+ */
+class TokenizedText {
+ public:
+  /**
+   * @param tokenizer   should outlive the text
+   */
+  explicit TokenizedText(const Tokenizer &tokenizer) : tokenizer_(tokenizer) {}
+
+  TokenizedText(const TokenizedText &) = delete;
+
+  TokenizedText &operator=(const TokenizedText &) = delete;
+
+  /**
+   * @brief     replace the whole text and lex it
+   * @return    whether succeed
+   */
+  bool Assign(std::string text);
+
+  /**
+   * @param offset          the begin of edited bytes
+   * @param removed_size    the number of bytes removed
+   * @param inserted        the text inserted at offset
+   * @return                whether succeed, if a lexing error occurs, the
+   *                        tokens end before the error
+   */
+  bool Edit(size_t offset, size_t removed_size, const std::string &inserted);
+
+  const std::string &text() const {
+    return text_;
+  }
+
+  /**
+   * @brief     the tokens refer to the text, and are valid until next edit.
+   *            The kept tokens shifted by edits are updated on reading.
+   */
+  const std::vector<TokenView> &tokens() const {
+    Flush();
+    return tokens_;
+  }
+
+  const TokenEdit &last_edit() const {
+    return last_edit_;
+  }
+
+  bool IsError() const {
+    return is_error_;
+  }
+
+ private:
+  /**
+   * @brief     the offsets of a token in text, scan_end is the maximum one of
+   *            this and all the tokens before, so it is sorted
+   */
+  struct TokenSpan {
+    size_t start;
+    size_t end;
+    size_t scan_end;
+  };
+
+  /**
+   * @brief             lex until the end of text, or a token is aligned
+   * @param scan_end    the scan_end of the token before cursor
+   * @param is_aligned  given the end offset and symbol of a token lexed,
+   *                    returns whether the old tokens could be kept after it
+   * @return            whether succeed
+   */
+  bool Lex(TokenizerCursor &cursor, size_t scan_end,
+           std::vector<TokenView> &tokens, std::vector<TokenSpan> &spans,
+           const std::function<bool(size_t, const Symbol &)> &is_aligned);
+
+  /**
+   * @brief     restore the cursor state after the index-th token
+   */
+  void RestoreCursor(TokenizerCursor &cursor, size_t index) const;
+
+  /**
+   * @return    the span of the index-th token with the pending shift
+   */
+  TokenSpan Span(size_t index) const;
+
+  /**
+   * @return    the row of the index-th token with the pending shift
+   */
+  size_t Row(size_t index) const {
+    return index < shift_begin_ ? tokens_[index].row
+                                : tokens_[index].row + row_shift_;
+  }
+
+  /**
+   * @brief     add the shifts to the offsets and row of the index-th token
+   */
+  void ShiftToken(size_t index, size_t offset_shift, size_t row_shift) const;
+
+  /**
+   * @brief     move the begin of pending shift to index, the tokens between
+   *            are shifted or unshifted, so the cost is the distance between
+   *            the edits
+   */
+  void MoveShiftBegin(size_t index);
+
+  /**
+   * @brief     apply the pending shift, and rebuild the stale text slices
+   */
+  void Flush() const;
+
+ private:
+  const Tokenizer &tokenizer_;
+  std::string text_;
+  mutable std::vector<TokenView> tokens_;
+  mutable std::vector<TokenSpan> spans_;
+
+  /**
+   * @brief     The tokens from shift_begin_ are kept after the edits, whose
+   *            offsets and rows are not shifted yet. The shifts are added
+   *            modulo, so they may be negative. The text slices of the
+   *            tokens from stale_begin_ refer to the text before the edits.
+   */
+  mutable size_t shift_begin_{0};
+  mutable size_t offset_shift_{0};
+  mutable size_t row_shift_{0};
+  mutable size_t stale_begin_{0};
+
+  TokenEdit last_edit_{0, 0, 0};
+  bool is_error_{false};
+};
@@ -0,0 +1,264 @@
+//
+// Created by Dyinnz on 16-10-8.
+//
+
+#include "tokenizer_gen.h"
+#include "simplelogger.h"
+
+#include <map>
+
+using std::vector;
+using std::string;
+using std::ostream;
+using std::endl;
+
+extern simple_logger::BaseLogger logger;
+
+namespace {
+
+constexpr size_t kNumbersPerLine = 16;
+
+string EscapeString(const string &s) {
+  string result;
+  for (char c : s) {
+    switch (c) {
+      case '\\': result += "\\\\";
+        break;
+      case '"': result += "\\\"";
+        break;
+      case '\n': result += "\\n";
+        break;
+      case '\t': result += "\\t";
+        break;
+      default:
+        if (isprint(static_cast<unsigned char>(c))) {
+          result += c;
+        } else {
+          char buffer[8];
+          snprintf(buffer, sizeof(buffer), "\\%03o",
+                   static_cast<unsigned char>(c));
+          result += buffer;
+        }
+    }
+  }
+  return result;
+}
+
+string SymbolExpr(const Symbol &symbol) {
+  return string("Symbol(")
+      + (symbol.IsTerminal() ? "Symbol::kTerminal" : "Symbol::kNonTerminal")
+      + ", " + std::to_string(symbol.ID())
+      + ", \"" + EscapeString(symbol.str()) + "\")";
+}
+
+template<class T>
+void EmitArray(ostream &os, const char *type, const char *name,
+               const T *data, size_t size) {
+  os << "constexpr " << type << ' ' << name << '[' << size << "] = {";
+  for (size_t i = 0; i < size; ++i) {
+    os << (0 == i % kNumbersPerLine ? "\n    " : " ")
+       << static_cast<int>(data[i]) << ',';
+  }
+  os << "\n};\n\n";
+}
+
+/**
+ * @brief   each state is a label, the transitions are grouped by the next
+ *          state, so that a switch has few branches
+ */
+void EmitScanner(ostream &os, const string &name, const DFATable &table) {
+  os << "const char *Scan" << name << "Token(const char *p, const char *end,"
+     << " int *priority) {\n"
+     << "  const char *accepted = nullptr;\n"
+     << "  goto S" << table.start() << ";\n\n";
+
+  for (size_t state = 0; state < table.size(); ++state) {
+    os << "S" << state << ":\n";
+    if (table.IsEnd(state)) {
+      os << "  accepted = p;\n"
+         << "  *priority = " << table.priority(state) << ";\n";
+    }
+
+    std::map<int, vector<size_t>> next_to_classes;
+    const int *row = table.transitions() + state * table.class_num();
+    for (size_t k = 0; k < table.class_num(); ++k) {
+      if (DFATable::kDeadState != row[k]) {
+        next_to_classes[row[k]].push_back(k);
+      }
+    }
+
+    if (next_to_classes.empty()) {
+      os << "  return accepted;\n\n";
+      continue;
+    }
+
+    os << "  if (p == end) return accepted;\n"
+       << "  switch (kByteToClass[static_cast<unsigned char>(*p++)]) {\n";
+    for (auto &pair : next_to_classes) {
+      os << "   ";
+      for (size_t k : pair.second) {
+        os << " case " << k << ':';
+      }
+      os << " goto S" << pair.first << ";\n";
+    }
+    os << "    default: return accepted;\n"
+       << "  }\n\n";
+  }
+
+  os << "}\n";
+}
+
+/**
+ * @brief   the slots of perfect hash are computed by the generator, and
+ *          checked again by the compiler
+ */
+void EmitKeywordTable(ostream &os, const string &name,
+                      const KeywordTable &keyword_table) {
+  os << "const Symbol *Find" << name << "Keyword(const char *p,"
+     << " size_t size) {\n";
+  if (keyword_table.empty()) {
+    os << "  return nullptr;\n"
+       << "}\n\n";
+    return;
+  }
+
+  auto &keywords = keyword_table.keywords();
+  size_t mask = keyword_table.slot_num() - 1;
+  vector<int> slots(keyword_table.slot_num(), KeywordTable::kEmptySlot);
+  for (size_t i = 0; i < keywords.size(); ++i) {
+    auto &text = keywords[i].first;
+    slots[KeywordTable::Hash(text.data(), text.size(), keyword_table.seed())
+        & mask] = static_cast<int>(i);
+  }
+
+  os << "  constexpr uint32_t kSeed = " << keyword_table.seed() << "u;\n"
+     << "  constexpr size_t kMask = " << mask << ";\n"
+     << "  static const int kSlots[" << slots.size() << "] = {";
+  for (size_t i = 0; i < slots.size(); ++i) {
+    os << (0 == i % kNumbersPerLine ? "\n      " : " ") << slots[i] << ',';
+  }
+  os << "\n  };\n"
+     << "  static const char *const kTexts[" << keywords.size() << "] = {";
+  for (auto &keyword : keywords) {
+    os << "\n      \"" << EscapeString(keyword.first) << "\",";
+  }
+  os << "\n  };\n"
+     << "  static const Symbol kSymbols[" << keywords.size() << "] = {";
+  for (auto &keyword : keywords) {
+    os << "\n      " << SymbolExpr(keyword.second) << ',';
+  }
+  os << "\n  };\n";
+
+  for (size_t slot = 0; slot < slots.size(); ++slot) {
+    if (KeywordTable::kEmptySlot == slots[slot]) {
+      continue;
+    }
+    auto &text = keywords[slots[slot]].first;
+    os << "  static_assert((KeywordTable::Hash(\"" << EscapeString(text)
+       << "\", " << text.size() << ", kSeed) & kMask) == " << slot
+       << ", \"not perfect\");\n";
+  }
+
+  os << "\n"
+     << "  int index = kSlots[KeywordTable::Hash(p, size, kSeed) & kMask];\n"
+     << "  if (KeywordTable::kEmptySlot == index\n"
+     << "      || strlen(kTexts[index]) != size\n"
+     << "      || 0 != memcmp(kTexts[index], p, size)) {\n"
+     << "    return nullptr;\n"
+     << "  }\n"
+     << "  return &kSymbols[index];\n"
+     << "}\n\n";
+}
+
+} // end of anonymous namespace
+
+bool GenerateTokenizer(const Tokenizer &tokenizer,
+                       const string &name,
+                       const string &header,
+                       ostream &header_os,
+                       ostream &source_os) {
+  const DFATable *table = tokenizer.GetTokenTable();
+  if (!table || table->size() == 0) {
+    logger.error("{}(): the tokenizer has no table", __func__);
+    return false;
+  }
+
+  header_os << "// Generated by tokenizer_gen, do not edit.\n\n"
+            << "#pragma once\n\n"
+            << "#include \"tokenizer.h\"\n\n"
+            << "Tokenizer Build" << name << "Tokenizer();\n\n"
+            << "const char *Scan" << name << "Token(const char *p,"
+            << " const char *end, int *priority);\n\n"
+            << "const Symbol *Find" << name << "Keyword(const char *p,"
+            << " size_t size);\n";
+
+  source_os << "// Generated by tokenizer_gen, do not edit.\n\n"
+            << "#include \"" << header << "\"\n\n"
+            << "namespace {\n\n"
+            << "constexpr int kStartState = " << table->start() << ";\n"
+            << "constexpr size_t kStateNum = " << table->size() << ";\n"
+            << "constexpr size_t kClassNum = " << table->class_num()
+            << ";\n\n";
+
+  EmitArray(source_os, "uint8_t", "kByteToClass",
+            table->byte_to_class(), CharClasses::kByteNum);
+  EmitArray(source_os, "int", "kTransitions",
+            table->transitions(), table->size() * table->class_num());
+  EmitArray(source_os, "int", "kPriorities",
+            table->priorities(), table->size());
+  EmitArray(source_os, "uint8_t", "kEnds", table->ends(), table->size());
+
+  source_os << "} // end of anonymous namespace\n\n";
+
+  // the tokenizer viewing the arrays
+  source_os << "Tokenizer Build" << name << "Tokenizer() {\n"
+            << "  TokenizerBuilder tokenizer_builder;\n"
+            << "  tokenizer_builder\n"
+            << "      .SetLineComment(\""
+            << EscapeString(tokenizer.GetLineComment()) << "\")\n"
+            << "      .SetBlockComment(\""
+            << EscapeString(tokenizer.GetBlockCommentStart()) << "\", \""
+            << EscapeString(tokenizer.GetBlockCommentEnd()) << "\")\n"
+            << "      .SetIgnoreSet({";
+  for (auto &symbol : tokenizer.GetIgnoreSet()) {
+    source_os << "\n          " << SymbolExpr(symbol) << ',';
+  }
+  source_os << "})\n"
+            << "      .SetTable(\n"
+            << "          std::make_shared<DFATable>(kStateNum, kStartState,"
+            << " kClassNum,\n"
+            << "                                     kByteToClass,"
+            << " kTransitions,\n"
+            << "                                     kPriorities, kEnds,"
+            << " nullptr),\n"
+            << "          {";
+  for (auto &symbol : tokenizer.GetPrioritySymbols()) {
+    source_os << "\n              " << SymbolExpr(symbol) << ',';
+  }
+  source_os << "})";
+
+  auto &keyword_table = tokenizer.GetKeywordTable();
+  if (!keyword_table.empty()) {
+    source_os << "\n      .SetKeywords(\n"
+              << "          {";
+    for (auto &keyword : keyword_table.keywords()) {
+      source_os << "\n              {\"" << EscapeString(keyword.first)
+                << "\", " << SymbolExpr(keyword.second) << "},";
+    }
+    source_os << "},\n"
+              << "          " << SymbolExpr(tokenizer.GetIdentifierSymbol())
+              << ",\n"
+              << "          " << keyword_table.seed() << "u, "
+              << keyword_table.slot_num() << ")";
+  }
+
+  source_os << ";\n"
+            << "  return tokenizer_builder.Build();\n"
+            << "}\n\n";
+
+  EmitScanner(source_os, name, *table);
+  source_os << "\n";
+  EmitKeywordTable(source_os, name, keyword_table);
+
+  return header_os.good() && source_os.good();
+}
@@ -0,0 +1,43 @@
+//
+// Created by Dyinnz on 16-10-8.
+//
+
+#pragma once
+
+#include <ostream>
+
+#include "tokenizer.h"
+
+/**
+ * @brief   Generate C++ source of a compiled tokenizer, so that the tokenizer
+ *          needs no construction at runtime.
+ *
+ * @details The generated source contains the minimized DFA as constexpr
+ *          arrays, and defines two functions:
+ *
+ *          Tokenizer Build<Name>Tokenizer();
+ *            build a tokenizer viewing the arrays.
+ *
+ *          const char *Scan<Name>Token(const char *p, const char *end,
+ *                                      int *priority);
+ *            a direct-coded scanner using goto between states, returns the
+ *            end of the longest token and set its priority, or returns
+ *            nullptr if no token matched.
+ *
+ *          const Symbol *Find<Name>Keyword(const char *p, size_t size);
+ *            classify an identifier by the keyword table, whose perfect hash
+ *            is checked at compile time. Returns nullptr if it is not a
+ *            keyword, or the tokenizer has no keyword table.
+ *
+ * @param tokenizer     the tokenizer to be generated
+ * @param name          used in the names of generated functions
+ * @param header        the name of generated header included by the source
+ * @param header_os     output of the generated header
+ * @param source_os     output of the generated source
+ * @return              whether succeed
+ */
+bool GenerateTokenizer(const Tokenizer &tokenizer,
+                       const std::string &name,
+                       const std::string &header,
+                       std::ostream &header_os,
+                       std::ostream &source_os);
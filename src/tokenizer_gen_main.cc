@@ -0,0 +1,51 @@
+//
+// Created by Dyinnz on 16-10-8.
+//
+
+#include <fstream>
+#include <iostream>
+
+#include "simplelogger.h"
+#include "tokenizer_gen.h"
+#include "expr_grammar.h"
+#include "golike_grammar.h"
+
+using namespace std;
+using namespace simple_logger;
+
+BaseLogger logger;
+
+/**
+ * usage: tokenizer_gen <golike|expr> <name> <output path without suffix>
+ */
+int main(int argc, char *argv[]) {
+  if (argc != 4) {
+    cerr << "usage: " << argv[0] << " <golike|expr> <name> <output>" << endl;
+    return 1;
+  }
+
+  string grammar = argv[1];
+  Tokenizer tokenizer;
+  if ("golike" == grammar) {
+    tokenizer = golike_grammar::BuildGolikeTokenizer();
+  } else if ("expr" == grammar) {
+    tokenizer = expr_grammar::BuildExprTokenizer();
+  } else {
+    cerr << "unknown grammar " << grammar << endl;
+    return 1;
+  }
+
+  string output = argv[3];
+  string header = output + ".h";
+  ofstream header_os(header);
+  ofstream source_os(output + ".cc");
+
+  // the source includes the header in the same directory
+  string header_name = header.substr(header.find_last_of('/') + 1);
+  if (!GenerateTokenizer(tokenizer, argv[2], header_name,
+                         header_os, source_os)) {
+    cerr << "could not generate " << output << endl;
+    return 1;
+  }
+  return 0;
+}
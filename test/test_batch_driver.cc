@@ -0,0 +1,133 @@
+//
+// Created by coder on 16-10-12.
+//
+
+#define CATCH_CONFIG_MAIN
+
+#include <atomic>
+
+#include "catch.hpp"
+#include "simplelogger.h"
+#include "golike_grammar.h"
+#include "batch_driver.h"
+#include "thread_pool.h"
+
+using namespace simple_logger;
+using namespace golike_grammar;
+BaseLogger logger;
+
+using std::string;
+using std::vector;
+
+static const string kTestPath("test/testgo/src/");
+
+TEST_CASE("Work stealing pool") {
+  WorkStealingPool pool(4);
+  REQUIRE(4 == pool.size());
+  size_t not_worker = WorkStealingPool::kNotWorker;
+  REQUIRE(not_worker == WorkStealingPool::CurrentWorker());
+
+  std::atomic<int> count{0};
+  std::atomic<int> outside_count{0};
+  for (int i = 0; i < 100; ++i) {
+    pool.Submit([&pool, &count, &outside_count] {
+      if (WorkStealingPool::CurrentWorker() >= pool.size()) {
+        outside_count += 1;
+      }
+
+      // the tasks submitted by a worker are pushed into its own deque
+      for (int j = 0; j < 10; ++j) {
+        pool.Submit([&count] { count += 1; });
+      }
+      count += 1;
+    });
+  }
+  pool.Wait();
+  REQUIRE(1100 == count);
+  REQUIRE(0 == outside_count);
+
+  pool.Submit([&count] { count += 1; });
+  pool.Wait();
+  REQUIRE(1101 == count);
+}
+
+TEST_CASE("Submit into another pool") {
+  WorkStealingPool large_pool(4);
+  WorkStealingPool small_pool(2);
+
+  // the workers of large pool are not the ones of small pool
+  std::atomic<int> count{0};
+  for (int i = 0; i < 100; ++i) {
+    large_pool.Submit([&small_pool, &count] {
+      small_pool.Submit([&count] { count += 1; });
+    });
+  }
+  large_pool.Wait();
+  small_pool.Wait();
+  REQUIRE(100 == count);
+}
+
+TEST_CASE("Collect source files") {
+  vector<string> files;
+  REQUIRE(CollectSourceFiles({kTestPath}, ".go", files));
+  REQUIRE(11 == files.size());
+  REQUIRE(std::is_sorted(files.begin(), files.end()));
+  REQUIRE(kTestPath + "main/hellogo.go" == files[0]);
+
+  files.clear();
+  REQUIRE(CollectSourceFiles({kTestPath + "simpleadd/add.go",
+                              kTestPath + "simplesub"}, ".go", files));
+  REQUIRE(2 == files.size());
+
+  files.clear();
+  REQUIRE(!CollectSourceFiles({kTestPath + "not-exist"}, ".go", files));
+  REQUIRE(files.empty());
+}
+
+TEST_CASE("Batch compiling") {
+  Grammar grammar = BuildGolikeGrammar();
+  LLTable ll_table;
+  REQUIRE(BuildLLTable(grammar, ll_table));
+  Tokenizer tokenizer = BuildGolikeTokenizer();
+
+  vector<string> files;
+  REQUIRE(CollectSourceFiles({kTestPath + "testcase"}, ".go", files));
+
+  // compile every file several times, to keep all the workers busy
+  vector<string> batch;
+  for (int i = 0; i < 8; ++i) {
+    batch.insert(batch.end(), files.begin(), files.end());
+  }
+  batch.push_back(kTestPath + "not-exist.go");
+
+  BatchDriver driver(tokenizer, grammar, ll_table,
+                     [] { return CreateGolikeGrammarData(); });
+
+  BatchReport sequential = driver.Run(batch, 1);
+  BatchReport parallel = driver.Run(batch, 4);
+
+  REQUIRE(1 == sequential.thread_num);
+  REQUIRE(4 == parallel.thread_num);
+  REQUIRE(batch.size() == parallel.files.size());
+  REQUIRE(1 == parallel.failed_num);
+  REQUIRE(!parallel.files.back().is_read);
+
+  size_t total_bytes = 0;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    auto &expected = sequential.files[i];
+    auto &actual = parallel.files[i];
+    REQUIRE(batch[i] == actual.path);
+    REQUIRE(expected.IsSucceed() == actual.IsSucceed());
+    // the testcases are parsed to the end, so lexed wholly
+    REQUIRE(actual.is_read == actual.is_lexed);
+    REQUIRE(expected.bytes == actual.bytes);
+    REQUIRE(expected.token_num == actual.token_num);
+    REQUIRE(actual.worker < parallel.thread_num);
+    total_bytes += actual.bytes;
+  }
+
+  REQUIRE(sequential.total_tokens == parallel.total_tokens);
+  REQUIRE(total_bytes == parallel.total_bytes);
+  REQUIRE(parallel.total_tokens > 0);
+  REQUIRE(parallel.BytesPerSecond() > 0);
+}
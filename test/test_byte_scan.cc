@@ -0,0 +1,69 @@
+//
+// Created by coder on 16-10-13.
+//
+
+#define CATCH_CONFIG_MAIN
+
+#include <random>
+#include <string>
+
+#include "catch.hpp"
+#include "byte_scan.h"
+
+using std::string;
+
+using namespace byte_scan;
+
+static const char *ScalarFind(const char *p, const char *end,
+                              const string &set, bool has_high, bool is_in) {
+  while (p < end
+      && detail::InSet(*p, set.data(), set.size(), has_high) != is_in) {
+    p += 1;
+  }
+  return p;
+}
+
+TEST_CASE("Find and skip bytes") {
+  std::mt19937 random(12345);
+  const string alphabet("ab \t\n\"*/\x80\xff");
+
+  for (int round = 0; round < 2000; ++round) {
+    string text(random() % 100, 'a');
+    for (auto &c : text) {
+      c = alphabet[random() % alphabet.size()];
+    }
+    const char *beg = text.data();
+    const char *end = beg + text.size();
+
+    string set;
+    for (size_t i = random() % 4; i > 0; --i) {
+      set.push_back(alphabet[random() % alphabet.size()]);
+    }
+    bool has_high = 0 == random() % 3;
+    size_t offset = text.empty() ? 0 : random() % text.size();
+
+    REQUIRE(ScalarFind(beg + offset, end, set, has_high, true) ==
+        FindAny(beg + offset, end, set.data(), set.size(), has_high));
+    REQUIRE(ScalarFind(beg + offset, end, set, has_high, false) ==
+        SkipAny(beg + offset, end, set.data(), set.size(), has_high));
+  }
+}
+
+TEST_CASE("Count bytes") {
+  string text(100, 'a');
+  const char *last = nullptr;
+  REQUIRE(0 == CountByte(text.data(), text.data() + text.size(), '\n', last));
+  REQUIRE(nullptr == last);
+
+  for (size_t i : {0, 15, 16, 31, 32, 33, 64, 97}) {
+    text[i] = '\n';
+  }
+  REQUIRE(8 == CountByte(text.data(), text.data() + text.size(), '\n', last));
+  REQUIRE(text.data() + 97 == last);
+
+  REQUIRE(4 == CountByte(text.data() + 1, text.data() + 33, '\n', last));
+  REQUIRE(text.data() + 32 == last);
+
+  REQUIRE(text.data() + 15
+              == FindByte(text.data() + 1, text.data() + 100, '\n'));
+}
@@ -5,8 +5,11 @@
 #define CATCH_CONFIG_MAIN
 #define DEBUG
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
+#include <random>
+#include <sstream>
 
 #include "catch.hpp"
 #include "simplelogger.h"
@@ -197,3 +200,258 @@ TEST_CASE("Parsing for main") {
   auto result = ll_parser.Parse(parse_data.get(), tokens);
   REQUIRE(result);
 }
+
+TEST_CASE("Parsing with operator table") {
+  auto ll_parser = GetLLParser();
+  REQUIRE(ll_parser.SetOperatorTable(kExpr, kUnaryExpr,
+                                     GolikeBinaryOperators(),
+                                     CreateGolikeOperatorHooks()));
+
+  const char *paths[] = {
+      "testcase/basic_type.go", "testcase/comment.go", "testcase/for.go",
+      "testcase/func.go", "testcase/if.go", "testcase/import.go",
+      "testcase/switch.go", "testcase/var.go", "simpleadd/add.go",
+      "simplesub/sub.go", "main/hellogo.go",
+  };
+  for (auto path : paths) {
+    INFO(path);
+    auto tokens = GetTokensFromFile(path);
+    auto parse_data = CreateGolikeGrammarData();
+    REQUIRE(ll_parser.Parse(parse_data.get(), tokens));
+  }
+
+  static auto tokenizer = BuildGolikeTokenizer();
+  vector<Token> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(
+      "package main\n\nvar x int = a + b * c - d\n", tokens));
+  auto parse_data = CreateGolikeGrammarData();
+  REQUIRE(ll_parser.Parse(parse_data.get(), tokens));
+
+  // the snippets of primary expression may link the operands to the nodes
+  // before, so only the operator nodes are checked
+  auto &node_stack = parse_data->node_stack();
+  auto iter = std::find_if(node_stack.begin(), node_stack.end(),
+                           [](AstNode *node) {
+                             return kSub == node->symbol();
+                           });
+  REQUIRE(node_stack.end() != iter);
+  auto sub_node = *iter;
+  REQUIRE(2 == sub_node->children().size());
+  REQUIRE("d" == sub_node->children().back()->str().str());
+
+  auto add_node = sub_node->children().front();
+  REQUIRE(kAdd == add_node->symbol());
+  REQUIRE(2 == add_node->children().size());
+  REQUIRE("a" == add_node->children().front()->str().str());
+  REQUIRE(kMul == add_node->children().back()->symbol());
+
+  tokens.clear();
+  REQUIRE(tokenizer.LexicalAnalyze(
+      "package main\n\nfunc F() {\n\treturn 1 +\n}\n", tokens));
+  REQUIRE(!ll_parser.Parse(CreateGolikeGrammarData().get(), tokens));
+}
+
+/*----------------------------------------------------------------------------*/
+
+static string GenerateSource(size_t func_num) {
+  std::ostringstream oss;
+  oss << "package main\n\nimport \"fmt\"\n\nvar g int = 1\n";
+  for (size_t i = 0; i < func_num; ++i) {
+    oss << "\nfunc F" << i << "(x int, y int) int {\n"
+        << "\tif x > y {\n"
+        << "\t\treturn x - y\n"
+        << "\t}\n"
+        << "\tfor i := 0; i < x; i++ {\n"
+        << "\t\ty += i * " << i << "\n"
+        << "\t}\n"
+        << "\treturn y\n"
+        << "}\n";
+  }
+  return oss.str();
+}
+
+static void FlattenNode(const AstNode *node, vector<string> &nodes) {
+  std::ostringstream oss;
+  oss << node->symbol() << ' ' << node->str() << ' ' << node->row() << ':'
+      << node->column() << ' ' << node->children().size();
+  nodes.push_back(oss.str());
+}
+
+static void FlattenAst(const AstNode *node, vector<string> &nodes) {
+  FlattenNode(node, nodes);
+  for (auto child : node->children()) {
+    FlattenAst(child, nodes);
+  }
+}
+
+/**
+ * @brief   the nodes on stack and their children, the snippets of primary
+ *          expression may link the nodes into cycles, so no deeper
+ */
+static vector<string> FlattenNodes(const vector<AstNode *> &node_stack) {
+  vector<string> nodes;
+  for (auto node : node_stack) {
+    FlattenNode(node, nodes);
+    for (auto child : node->children()) {
+      FlattenNode(child, nodes);
+    }
+  }
+  return nodes;
+}
+
+static vector<string> FlattenAst(const vector<AstNode *> &subtrees) {
+  vector<string> nodes;
+  for (auto subtree : subtrees) {
+    FlattenAst(subtree, nodes);
+  }
+  return nodes;
+}
+
+/**
+ * @brief   parse the source fused with lexing, which has the same result and
+ *          nodes of parsing the tokens lexed first
+ */
+static void TestFusedParsing(LLParser &ll_parser, const string &source,
+                             bool expected) {
+  static auto tokenizer = BuildGolikeTokenizer();
+  vector<TokenView> tokens;
+  auto parse_data = CreateGolikeGrammarData();
+  bool is_lexed = tokenizer.LexicalAnalyze(source, tokens);
+  REQUIRE(expected == (is_lexed && ll_parser.Parse(parse_data.get(), tokens)));
+
+  TokenizerCursor cursor(tokenizer, source.data(),
+                         source.data() + source.size());
+  auto fused_data = CreateGolikeGrammarData();
+  REQUIRE(expected == ll_parser.Parse(fused_data.get(), cursor));
+  if (expected) {
+    REQUIRE(tokens.size() - 1 == cursor.token_num());
+    REQUIRE(FlattenNodes(parse_data->node_stack())
+                == FlattenNodes(fused_data->node_stack()));
+  }
+}
+
+TEST_CASE("Parsing fused with lexing") {
+  const char *paths[] = {
+      "testcase/basic_type.go", "testcase/comment.go", "testcase/for.go",
+      "testcase/func.go", "testcase/if.go", "testcase/import.go",
+      "testcase/switch.go", "testcase/var.go", "simpleadd/add.go",
+      "simplesub/sub.go", "main/hellogo.go",
+  };
+  auto ll_parser = GetLLParser();
+  for (auto path : paths) {
+    INFO(path);
+    GET_FILE_DATA_SAFELY(data, size, path);
+    REQUIRE(data);
+    TestFusedParsing(ll_parser, string(data, size), true);
+  }
+
+  TestFusedParsing(ll_parser, "package main\n\nfunc F() {\n", false);
+  TestFusedParsing(ll_parser, "package main\n\nvar x int = @\n", false);
+
+  REQUIRE(ll_parser.SetOperatorTable(kExpr, kUnaryExpr,
+                                     GolikeBinaryOperators(),
+                                     CreateGolikeOperatorHooks()));
+  TestFusedParsing(ll_parser, "package main\n\nvar x int = a + b * c\n",
+                   true);
+}
+
+TEST_CASE("Incremental parsing") {
+  static Grammar grammar = BuildGolikeGrammar();
+  static LLTable ll_table;
+  static bool is_built = BuildLLTable(grammar, ll_table);
+  REQUIRE(is_built);
+
+  const Tokenizer tokenizer = BuildGolikeTokenizer();
+  TokenizedText text(tokenizer);
+  REQUIRE(text.Assign(GenerateSource(20)));
+
+  IncrementalLLParser parser(grammar, ll_table, kTopDeclRecur,
+                             CreateGolikeSubtreeHooks());
+  auto parse_data = CreateGolikeGrammarData();
+
+  // the incremental result is the same with parsing again
+  auto reparse = [&]() {
+    auto tokens = text.tokens();
+    bool result = parser.Reparse(parse_data.get(), tokens, text.last_edit());
+
+    IncrementalLLParser full_parser(grammar, ll_table, kTopDeclRecur,
+                                    CreateGolikeSubtreeHooks());
+    auto full_data = CreateGolikeGrammarData();
+    auto full_tokens = text.tokens();
+    REQUIRE(result == full_parser.Parse(full_data.get(), full_tokens));
+    if (result) {
+      REQUIRE(FlattenAst(full_parser.subtrees())
+                  == FlattenAst(parser.subtrees()));
+    }
+    return result;
+  };
+
+  auto tokens = text.tokens();
+  REQUIRE(parser.Parse(parse_data.get(), tokens));
+  REQUIRE(22 == parser.subtrees().size());
+  REQUIRE(kVar == parser.subtrees()[1]->children().front()->symbol());
+  REQUIRE(kFunctionDecl == parser.subtrees()[2]->symbol());
+  REQUIRE(0 == parser.reused_num());
+
+  auto &source = text.text();
+
+  SECTION("edit in a function") {
+    size_t offset = source.find("i * 7");
+    REQUIRE(text.Edit(offset, 1, "x + y"));
+    REQUIRE(reparse());
+    REQUIRE(20 == parser.reused_num());
+  }
+
+  SECTION("insert and remove lines") {
+    size_t offset = source.find("\nfunc F3");
+    REQUIRE(text.Edit(offset, 0, "\nvar h int = 2\n\n"));
+    REQUIRE(reparse());
+    REQUIRE(23 == parser.subtrees().size());
+    // the LF ending F2 and the func of F3 are lexed again
+    REQUIRE(19 == parser.reused_num());
+
+    REQUIRE(text.Edit(offset, 16, ""));
+    REQUIRE(reparse());
+    REQUIRE(22 == parser.subtrees().size());
+    REQUIRE(19 == parser.reused_num());
+  }
+
+  SECTION("error and fix") {
+    size_t offset = source.find("return y\n}\n\nfunc F10");
+    REQUIRE(text.Edit(offset, 6, "return {"));
+    REQUIRE_FALSE(reparse());
+    REQUIRE(text.Edit(offset, 8, "return"));
+    REQUIRE(reparse());
+  }
+
+  SECTION("edit in the head") {
+    REQUIRE(text.Edit(source.find("main"), 4, "other"));
+    REQUIRE(reparse());
+    REQUIRE(0 == parser.reused_num());
+  }
+
+  SECTION("random edits") {
+    std::mt19937 random(20161017);
+    const string pieces[] = {"", " ", "\n", "x", "1", "+", "}", "{", "(", ")",
+                             "func", "return", "var a int\n"};
+    // the string literal in the head is not broken
+    size_t head_size = source.find("var g");
+    size_t reused_num = 0;
+    for (int k = 0; k < 200; ++k) {
+      size_t offset = head_size + random() % (source.size() - head_size + 1);
+      size_t removed_size = std::min<size_t>(random() % 3,
+                                             source.size() - offset);
+      auto &inserted = pieces[random() % (sizeof(pieces) / sizeof(*pieces))];
+      string removed = source.substr(offset, removed_size);
+      REQUIRE(text.Edit(offset, removed_size, inserted));
+      if (reparse()) {
+        reused_num += parser.reused_num();
+      } else {
+        // undo the broken edit
+        REQUIRE(text.Edit(offset, inserted.size(), removed));
+        REQUIRE(reparse());
+      }
+    }
+    logger.log("{} items reused by the random edits", reused_num);
+  }
+}
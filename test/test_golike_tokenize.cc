@@ -5,8 +5,14 @@
 #define CATCH_CONFIG_MAIN
 #define DEBUG
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <random>
+#include <sstream>
 
 #include "catch.hpp"
 #include "simplelogger.h"
@@ -133,3 +139,416 @@ TEST_CASE("Tokenizer for sub") {
 TEST_CASE("Tokenizer for comment") {
   TestTokenizeFile("testcase/comment.go");
 }
+
+TEST_CASE("Tokenizer save and load") {
+  GET_FILE_DATA_SAFELY(data, size, "testcase/comment.go")
+  REQUIRE(data);
+
+  auto tokenizer = BuildGolikeTokenizer();
+  const string path = "golike_tokenizer.bin";
+  REQUIRE(tokenizer.Save(path));
+
+  TokenizerBuilder builder;
+  auto loaded = builder.Load(path).Build();
+  REQUIRE_FALSE(builder.IsError());
+  REQUIRE(nullptr == loaded.GetTokenDFA());
+  REQUIRE(tokenizer.GetTokenTable()->size() == loaded.GetTokenTable()->size());
+
+  std::vector<Token> tokens;
+  std::vector<Token> loaded_tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(data, data + size, tokens));
+  REQUIRE(loaded.LexicalAnalyze(data, data + size, loaded_tokens));
+  REQUIRE(tokens == loaded_tokens);
+  REQUIRE(string(tokens[0].symbol.str()) == loaded_tokens[0].symbol.str());
+
+  // the names of symbols outlive the loaded tokenizer and its mapped file
+  std::vector<Token> outliving_tokens;
+  {
+    TokenizerBuilder scoped_builder;
+    auto scoped = scoped_builder.Load(path).Build();
+    REQUIRE(scoped.LexicalAnalyze(data, data + size, outliving_tokens));
+  }
+  REQUIRE(tokens == outliving_tokens);
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    REQUIRE(string(tokens[i].symbol.str()) == outliving_tokens[i].symbol.str());
+  }
+
+  TokenizerBuilder broken_builder;
+  broken_builder.Load(kTestPath + "testcase/comment.go");
+  REQUIRE(broken_builder.IsError());
+
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Tokenize to views") {
+  GET_FILE_DATA_SAFELY(data, size, "testcase/func.go")
+  REQUIRE(data);
+
+  auto tokenizer = BuildGolikeTokenizer();
+  std::vector<Token> tokens;
+  std::vector<TokenView> token_views;
+  REQUIRE(tokenizer.LexicalAnalyze(data, data + size, tokens));
+  REQUIRE(tokenizer.LexicalAnalyze(data, data + size, token_views));
+
+  REQUIRE(tokens.size() == token_views.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    REQUIRE(tokens[i].view() == token_views[i]);
+    REQUIRE(tokens[i].row == token_views[i].row);
+    REQUIRE(tokens[i].column == token_views[i].column);
+
+    // refer to the source text except the LF
+    if (kLFSymbol != token_views[i].symbol) {
+      REQUIRE(data <= token_views[i].text.data());
+      REQUIRE(token_views[i].text.end() <= data + size);
+    }
+  }
+}
+
+TEST_CASE("Pull tokens from cursor") {
+  auto tokenizer = BuildGolikeTokenizer();
+  for (auto path : {"testcase/comment.go", "testcase/func.go",
+                    "main/hellogo.go"}) {
+    GET_FILE_DATA_SAFELY(data, size, path)
+    REQUIRE(data);
+
+    std::vector<TokenView> tokens;
+    REQUIRE(tokenizer.LexicalAnalyze(data, data + size, tokens));
+
+    TokenizerCursor cursor(tokenizer, data, data + size);
+    TokenView token(TextSlice(), kErrorSymbol);
+    size_t count = 0;
+    while (cursor.Next(token)) {
+      REQUIRE(count < tokens.size());
+      REQUIRE(tokens[count] == token);
+      REQUIRE(tokens[count].row == token.row);
+      REQUIRE(tokens[count].column == token.column);
+      count += 1;
+    }
+    REQUIRE_FALSE(cursor.IsError());
+    REQUIRE(tokens.size() == count);
+    REQUIRE(count == cursor.token_num());
+    REQUIRE_FALSE(cursor.Next(token));
+  }
+
+  const string error_source("package main\n\nvar x = @\n");
+  TokenizerCursor cursor(tokenizer, error_source.data(),
+                         error_source.data() + error_source.size());
+  TokenView token(TextSlice(), kErrorSymbol);
+  while (cursor.Next(token)) {}
+  REQUIRE(cursor.IsError());
+  REQUIRE(kAssign == token.symbol);
+}
+
+static void TestTokenStream(const string &path, size_t chunk_size) {
+  GET_FILE_DATA_SAFELY(data, size, path)
+  REQUIRE(data);
+
+  static auto tokenizer = BuildGolikeTokenizer();
+  std::vector<TokenView> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(data, data + size, tokens));
+
+  std::istringstream iss(string(data, size));
+  TokenStream token_stream(tokenizer, iss, chunk_size);
+
+  size_t count = 0;
+  TokenView token(TextSlice(), kErrorSymbol);
+  while (token_stream.Next(token)) {
+    REQUIRE(count < tokens.size());
+    REQUIRE(tokens[count] == token);
+    REQUIRE(tokens[count].row == token.row);
+    REQUIRE(tokens[count].column == token.column);
+    count += 1;
+  }
+  REQUIRE_FALSE(token_stream.IsError());
+  REQUIRE(tokens.size() == count);
+}
+
+TEST_CASE("Token stream") {
+  for (size_t chunk_size : {1, 3, 7, 4096}) {
+    TestTokenStream("testcase/comment.go", chunk_size);
+    TestTokenStream("testcase/func.go", chunk_size);
+    TestTokenStream("main/hellogo.go", chunk_size);
+  }
+}
+
+TEST_CASE("Fast paths of spaces, comments and strings") {
+  // the token stream walks byte by byte, without the fast paths
+  auto tokenizer = BuildGolikeTokenizer();
+  string spaces(70, ' ');
+  spaces += "\t\v\f\r";
+
+  string source = "a :=" + spaces + "\"" + string(103, 'x') + "\"\n"
+      + "b" + spaces + "= 1 // " + string(90, '*') + "\n"
+      + "/*" + string(40, '*') + "\n\n" + string(33, '/') + "\n*/ c := \"\"\n"
+      + "/** " + string(64, '\n') + "**/ d" + spaces + "\n"
+      + "e := \"" + string(31, 'y') + "\"" + spaces;
+
+  std::vector<TokenView> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(source, tokens));
+
+  std::istringstream iss(source);
+  TokenStream token_stream(tokenizer, iss, 4096);
+  size_t count = 0;
+  TokenView token(TextSlice(), kErrorSymbol);
+  while (token_stream.Next(token)) {
+    REQUIRE(count < tokens.size());
+    REQUIRE(tokens[count] == token);
+    REQUIRE(tokens[count].row == token.row);
+    REQUIRE(tokens[count].column == token.column);
+    count += 1;
+  }
+  REQUIRE(tokens.size() == count);
+  REQUIRE(kStringLit == tokens[2].symbol);
+  REQUIRE(105 == tokens[2].text.size());
+  REQUIRE(72 == tokens.back().row);
+
+  // the unterminated comment and string
+  tokens.clear();
+  const string comment = "a /* " + string(50, '\n');
+  REQUIRE(tokenizer.LexicalAnalyze(comment, tokens));
+  REQUIRE(1 == tokens.size());
+  const string literal = "a \"" + string(50, 'z');
+  REQUIRE_FALSE(tokenizer.LexicalAnalyze(literal, tokens));
+
+  // the high bytes stop the string literal too
+  const string high_literal = literal + "\xe4\xbd\xa0\"";
+  REQUIRE_FALSE(tokenizer.LexicalAnalyze(high_literal, tokens));
+}
+
+TEST_CASE("Token stream from file descriptor") {
+  auto tokenizer = BuildGolikeTokenizer();
+  int fd = open((kTestPath + "testcase/switch.go").c_str(), O_RDONLY);
+  REQUIRE(-1 != fd);
+
+  TokenStream token_stream(tokenizer, fd, 5);
+  TokenView token(TextSlice(), kErrorSymbol);
+  size_t count = 0;
+  while (token_stream.Next(token)) {
+    count += 1;
+  }
+  close(fd);
+
+  REQUIRE_FALSE(token_stream.IsError());
+  REQUIRE(count > 0);
+
+  // error token
+  std::istringstream iss("a := `b`");
+  TokenStream error_stream(tokenizer, iss, 2);
+  REQUIRE(error_stream.Next(token));
+  REQUIRE(kIdentifier == token.symbol);
+  REQUIRE(error_stream.Next(token));
+  REQUIRE_FALSE(error_stream.Next(token));
+  REQUIRE(error_stream.IsError());
+}
+
+static void TestParallelTokenize(const string &source) {
+  static auto tokenizer = BuildGolikeTokenizer();
+  const char *beg = source.c_str();
+  const char *end = beg + source.length();
+
+  std::vector<TokenView> tokens;
+  bool result = tokenizer.LexicalAnalyze(beg, end, tokens);
+
+  for (size_t thread_num : {2, 3, 8}) {
+    for (size_t min_chunk_size : {1, 16, 64}) {
+      std::vector<TokenView> parallel_tokens;
+      REQUIRE(result == tokenizer.ParallelLexicalAnalyze(
+          beg, end, parallel_tokens, thread_num, min_chunk_size));
+      if (!result) {
+        continue;
+      }
+
+      REQUIRE(tokens.size() == parallel_tokens.size());
+      for (size_t i = 0; i < tokens.size(); ++i) {
+        REQUIRE(tokens[i] == parallel_tokens[i]);
+        REQUIRE(tokens[i].row == parallel_tokens[i].row);
+        REQUIRE(tokens[i].column == parallel_tokens[i].column);
+      }
+    }
+  }
+}
+
+TEST_CASE("Parallel tokenize") {
+  for (auto path : {"testcase/comment.go", "testcase/func.go",
+                    "testcase/switch.go", "main/hellogo.go"}) {
+    GET_FILE_DATA_SAFELY(data, size, path)
+    REQUIRE(data);
+    TestParallelTokenize(string(data, size));
+  }
+
+  // the guessed starts are in block comments and string literals
+  TestParallelTokenize("a := 1\n/* x := \"\n\n y */ b := \"2\n\n\nc\" + d\n"
+                       "\n\n// \"\nvar e = \"/*\n*/\"\nf()\n/*\n\n\n*/\n");
+
+  // error in the middle
+  TestParallelTokenize("a := 1\nb := 2\nc := `3`\nd := 4\ne := 5\n");
+}
+
+TEST_CASE("Shared tokenizer") {
+  GET_FILE_DATA_SAFELY(data, size, "testcase/func.go")
+  REQUIRE(data);
+
+  const Tokenizer tokenizer = BuildGolikeTokenizer();
+  std::vector<TokenView> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(data, data + size, tokens));
+
+  // a cursor could lex from the middle of text
+  TokenizerCursor cursor(tokenizer, data, data + size);
+  const char *p = data;
+  TokenView first = cursor.GetNextToken(p);
+  REQUIRE(tokens[0] == first);
+  REQUIRE(data == cursor.CurrentPos());
+
+  std::vector<TokenView> cursor_tokens;
+  REQUIRE(cursor.LexicalAnalyze(cursor_tokens));
+  REQUIRE(data + size == cursor.CurrentPos());
+  REQUIRE(tokens == cursor_tokens);
+
+  // many threads lex with the same tokenizer
+  const size_t kThreadNum = 8;
+  std::vector<std::vector<TokenView>> results(kThreadNum);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreadNum; ++i) {
+    threads.emplace_back([&tokenizer, &results, data, size, i] {
+      for (int k = 0; k < 20; ++k) {
+        results[i].clear();
+        tokenizer.LexicalAnalyze(data, data + size, results[i]);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (auto &result : results) {
+    REQUIRE(tokens.size() == result.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      REQUIRE(tokens[i] == result[i]);
+      REQUIRE(tokens[i].row == result[i].row);
+      REQUIRE(tokens[i].column == result[i].column);
+    }
+  }
+}
+
+/*----------------------------------------------------------------------------*/
+
+static void RequireSameTokens(const Tokenizer &tokenizer,
+                              const TokenizedText &text) {
+  auto &source = text.text();
+  std::vector<TokenView> tokens;
+  bool result = tokenizer.LexicalAnalyze(source.data(),
+                                         source.data() + source.size(),
+                                         tokens);
+  REQUIRE(result == !text.IsError());
+
+  auto &incremental = text.tokens();
+  REQUIRE(tokens.size() == incremental.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    REQUIRE(tokens[i] == incremental[i]);
+    REQUIRE(tokens[i].row == incremental[i].row);
+    REQUIRE(tokens[i].column == incremental[i].column);
+  }
+}
+
+TEST_CASE("Incremental tokenize") {
+  const Tokenizer tokenizer = BuildGolikeTokenizer();
+
+  SECTION("local edits") {
+    TokenizedText text(tokenizer);
+    REQUIRE(text.Assign("a := 1\nb := a + 2\nc := \"s\"\n"));
+    REQUIRE(14 == text.tokens().size());
+
+    // rename an identifier, the LF before it examined the first byte
+    REQUIRE(text.Edit(7, 1, "bb"));
+    RequireSameTokens(tokenizer, text);
+    REQUIRE(3 == text.last_edit().first);
+    REQUIRE(2 == text.last_edit().removed_num);
+    REQUIRE(2 == text.last_edit().inserted_num);
+    REQUIRE(3 == text.tokens()[5].column);
+
+    // join two lines
+    REQUIRE(text.Edit(6, 1, " + "));
+    RequireSameTokens(tokenizer, text);
+    REQUIRE(1 == text.tokens()[4].row);
+
+    // split them again, the rows after are moved
+    REQUIRE(text.Edit(6, 3, "\n\n"));
+    RequireSameTokens(tokenizer, text);
+    REQUIRE(4 == text.tokens().back().row);
+
+    // open a block comment, then close it
+    REQUIRE(text.Edit(0, 0, "/*"));
+    RequireSameTokens(tokenizer, text);
+    REQUIRE(text.Edit(9, 0, "*/"));
+    RequireSameTokens(tokenizer, text);
+
+    // an unclosed string is an error, which is fixed by a later edit
+    REQUIRE_FALSE(text.Edit(text.text().size() - 2, 1, ""));
+    RequireSameTokens(tokenizer, text);
+    REQUIRE(text.Edit(text.text().size() - 1, 0, "\""));
+    RequireSameTokens(tokenizer, text);
+
+    REQUIRE_FALSE(text.Edit(text.text().size(), 1, ""));
+  }
+
+  SECTION("random edits") {
+    std::mt19937 random(20161017);
+    const string pieces[] = {"", " ", "\n", "x", "1", ".", "/", "*", "\"s\"",
+                             "// c\n", "/* c */", "}", "{", ":=", "=",
+                             "func", "for", "e", "\t", "+"};
+
+    for (auto path : {"testcase/comment.go", "testcase/func.go",
+                      "testcase/switch.go", "main/hellogo.go"}) {
+      GET_FILE_DATA_SAFELY(data, size, path)
+      REQUIRE(data);
+
+      TokenizedText text(tokenizer);
+      REQUIRE(text.Assign(string(data, size)));
+      RequireSameTokens(tokenizer, text);
+
+      size_t total_removed = 0;
+      for (int k = 0; k < 300; ++k) {
+        size_t text_size = text.text().size();
+        size_t offset = random() % (text_size + 1);
+        size_t removed_size = std::min<size_t>(random() % 4,
+                                               text_size - offset);
+        auto &inserted = pieces[random() % (sizeof(pieces) / sizeof(*pieces))];
+
+        text.Edit(offset, removed_size, inserted);
+        RequireSameTokens(tokenizer, text);
+        if (!text.IsError()) {
+          total_removed += text.last_edit().removed_num;
+        }
+      }
+      logger.log("{} tokens removed by the edits of {}", total_removed, path);
+      // the local edits re-lex a few tokens
+      REQUIRE(total_removed < 300 * 4);
+    }
+  }
+
+  SECTION("edits between reads") {
+    std::mt19937 random(20161018);
+    const string pieces[] = {"", " ", "\n", "x", "// c\n", "/* c */", "\"s\"",
+                             "\n\n", "}", "+"};
+
+    GET_FILE_DATA_SAFELY(data, size, "testcase/func.go")
+    REQUIRE(data);
+
+    // the kept tokens are shifted lazily, back and forth between the edits
+    TokenizedText text(tokenizer);
+    REQUIRE(text.Assign(string(data, size)));
+    for (int k = 0; k < 300; ++k) {
+      size_t text_size = text.text().size();
+      size_t offset = random() % (text_size + 1);
+      size_t removed_size = std::min<size_t>(random() % 4,
+                                             text_size - offset);
+      auto &inserted = pieces[random() % (sizeof(pieces) / sizeof(*pieces))];
+
+      text.Edit(offset, removed_size, inserted);
+      if (6 == k % 7) {
+        RequireSameTokens(tokenizer, text);
+      }
+    }
+    RequireSameTokens(tokenizer, text);
+  }
+}
@@ -5,6 +5,8 @@
 #define CATCH_CONFIG_MAIN
 #define DEBUG
 
+#include <sstream>
+
 #include "catch.hpp"
 #include "simplelogger.h"
 #include "ll_parser.h"
@@ -19,47 +21,60 @@ using expr_grammar::to_string;
 
 BaseLogger logger;
 
+static void PrintTerminalSet(const Grammar &grammar, const TerminalSet &set) {
+  set.ForEach([&](size_t terminal) {
+    cout << to_string(grammar.terminals()[terminal]) << " ";
+  });
+  cout << endl;
+}
+
 TEST_CASE("test first set", "[First]") {
-  Grammar grammar = expr_grammar::BuildExprGrammar();
-  auto firsts = CalcFirst(grammar);
+  using namespace expr_grammar;
+  Grammar grammar = BuildExprGrammar();
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
 
   cout << "========= the First set =========" << endl;
-  for (auto &p : firsts) {
-    auto &symbol = p.first;
-    auto &first = p.second;
-    cout << "[Symbol] " << to_string(symbol) << endl;
-    for (auto &terminal : first) {
-      cout << to_string(terminal) << " ";
-    }
-    cout << endl;
+  for (size_t i = 0; i < grammar.nonterminals().size(); ++i) {
+    cout << "[Symbol] " << to_string(grammar.nonterminals()[i]) << endl;
+    PrintTerminalSet(grammar, first_follow.first(i));
   }
+
+  auto &expr_first = first_follow.first(grammar.SymbolIndex(kExpr));
+  REQUIRE(expr_first.Test(grammar.SymbolIndex(kLeftParen)));
+  REQUIRE(expr_first.Test(grammar.SymbolIndex(kNumber)));
+  REQUIRE(expr_first.Test(grammar.SymbolIndex(kName)));
+  REQUIRE(!expr_first.Test(grammar.SymbolIndex(kEpsilonSymbol)));
+  REQUIRE(first_follow.first(grammar.SymbolIndex(kExprRecur))
+              .Test(grammar.SymbolIndex(kEpsilonSymbol)));
 }
 
 TEST_CASE("test follow set", "[Follow]") {
-  Grammar grammar = expr_grammar::BuildExprGrammar();
-  auto firsts = CalcFirst(grammar);
-  auto follows = CalcFollow(grammar, firsts);
+  using namespace expr_grammar;
+  Grammar grammar = BuildExprGrammar();
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
 
   cout << "========= the Follow set =========" << endl;
-  for (auto &p : follows) {
-    auto &symbol = p.first;
-    auto &follow = p.second;
-    cout << "[Symbol] " << to_string(symbol) << endl;
-    for (auto &terminal : follow) {
-      cout << to_string(terminal) << " ";
-    }
-    cout << endl;
+  for (size_t i = 0; i < grammar.nonterminals().size(); ++i) {
+    cout << "[Symbol] " << to_string(grammar.nonterminals()[i]) << endl;
+    PrintTerminalSet(grammar, first_follow.follow(i));
   }
+
+  auto &term_follow = first_follow.follow(grammar.SymbolIndex(kTermRecur));
+  REQUIRE(term_follow.Test(grammar.SymbolIndex(kAdd)));
+  REQUIRE(term_follow.Test(grammar.SymbolIndex(kRightParen)));
+  REQUIRE(term_follow.Test(grammar.SymbolIndex(kEofSymbol)));
+  REQUIRE(!term_follow.Test(grammar.SymbolIndex(kMul)));
 }
 
 TEST_CASE("test extend first set", "[First+]") {
   Grammar grammar = expr_grammar::BuildExprGrammar();
-  auto firsts = CalcFirst(grammar);
-  auto follows = CalcFollow(grammar, firsts);
-  auto extend_firsts = CalcExtendFirst(grammar, firsts, follows);
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
 
   cout << "========= the Extend First set =========" << endl;
-  for (size_t i = 0; i < extend_firsts.size(); ++i) {
+  for (size_t i = 0; i < grammar.RuleNumber(); ++i) {
     auto &rule = grammar.GetRule(i);
     cout << "[Rule " << i << "] " << to_string(rule.left()) << "-> ";
     for (auto &right_part : rule.right()) {
@@ -68,33 +83,79 @@ TEST_CASE("test extend first set", "[First+]") {
     cout << endl;
 
     cout << "[First] ";
-    for (auto &terminal : extend_firsts[i]) {
-      cout << to_string(terminal) << " ";
-    }
-    cout << endl;
+    PrintTerminalSet(grammar, first_follow.RuleFirst(grammar, i));
+  }
+}
+
+TEST_CASE("test incremental first follow", "[First Follow]") {
+  using namespace expr_grammar;
+  Grammar grammar = BuildExprGrammar();
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
+  size_t full_visited_num = first_follow.visited_num();
+
+  // a variant with unary minus: Factor -> - Factor
+  GrammarBuilder builder(std::move(grammar));
+  builder.InsertRule(kFactor, {kSub, kFactor}, [](void *) {});
+  grammar = builder.Build();
+  first_follow.Update(grammar);
+  REQUIRE(first_follow.visited_num() < full_visited_num);
+
+  FirstFollow expected;
+  expected.Update(grammar);
+  for (size_t i = 0; i < grammar.nonterminals().size(); ++i) {
+    REQUIRE(expected.first(i) == first_follow.first(i));
+    REQUIRE(expected.follow(i) == first_follow.follow(i));
   }
+  REQUIRE(first_follow.first(grammar.SymbolIndex(kStartSymbol))
+              .Test(grammar.SymbolIndex(kSub)));
+
+  LLTable ll_table;
+  REQUIRE(BuildLLTable(grammar, first_follow, ll_table));
+  REQUIRE(12 == ll_table.Get(grammar.SymbolIndex(kFactor),
+                             grammar.SymbolIndex(kSub)));
 }
 
 TEST_CASE("test ll table", "[LL SymbolTable]") {
   Grammar grammar = expr_grammar::BuildExprGrammar();
-  auto firsts = CalcFirst(grammar);
-  auto follows = CalcFollow(grammar, firsts);
-  auto extend_firsts = CalcExtendFirst(grammar, firsts, follows);
+  FirstFollow first_follow;
+  first_follow.Update(grammar);
 
   LLTable ll_table;
-  bool result = BuildLLTable(grammar, extend_firsts, ll_table);
+  bool result = BuildLLTable(grammar, first_follow, ll_table);
 
   REQUIRE(result);
 
+  // the symbols are numbered densely by type
+  using namespace expr_grammar;
+  REQUIRE(6 == grammar.nonterminals().size());
+  REQUIRE(10 == grammar.terminals().size());
+  REQUIRE(kExpr == grammar.nonterminals()[grammar.SymbolIndex(kExpr)]);
+  REQUIRE(kName == grammar.terminals()[grammar.SymbolIndex(kName)]);
+  REQUIRE(SIZE_MAX == grammar.SymbolIndex(kLFSymbol));
+
+  auto get_rule = [&](const Symbol &nonterminal, const Symbol &terminal) {
+    return ll_table.Get(grammar.SymbolIndex(nonterminal),
+                        grammar.SymbolIndex(terminal));
+  };
+  REQUIRE(0 == get_rule(kStartSymbol, kName));
+  REQUIRE(3 == get_rule(kExprRecur, kSub));
+  REQUIRE(4 == get_rule(kExprRecur, kRightParen));
+  REQUIRE(4 == get_rule(kExprRecur, kEofSymbol));
+  REQUIRE(9 == get_rule(kFactor, kLeftParen));
+  REQUIRE(LLTable::kErrorRule == get_rule(kFactor, kAdd));
+
   cout << "========= test LL(1) SymbolTable =========" << endl;
-  for (auto &nonterminal_pair : ll_table) {
-    auto &nonterminal = nonterminal_pair.first;
-    auto &jump_map = nonterminal_pair.second;
+  for (size_t i = 0; i < ll_table.nonterminal_num(); ++i) {
+    auto &nonterminal = grammar.nonterminals()[i];
 
     cout << "[Nonterminal] " << to_string(nonterminal) << endl;
-    for (auto &p : jump_map) {
-      auto &terminal = p.first;
-      auto rule_index = p.second;
+    for (size_t k = 0; k < ll_table.terminal_num(); ++k) {
+      auto &terminal = grammar.terminals()[k];
+      auto rule_index = ll_table.Get(i, k);
+      if (LLTable::kErrorRule == rule_index) {
+        continue;
+      }
 
       cout << "{" << to_string(terminal) << "->" << rule_index << "}" << " ";
     }
@@ -102,6 +163,38 @@ TEST_CASE("test ll table", "[LL SymbolTable]") {
   }
 }
 
+TEST_CASE("test ll table report", "[LL Report]") {
+  using namespace expr_grammar;
+  Grammar grammar = BuildExprGrammar();
+
+  LLTable ll_table;
+  LLTableReport report;
+  REQUIRE(BuildLLTable(grammar, ll_table, &report));
+  REQUIRE(report.conflicts.empty());
+  REQUIRE(6 == report.firsts.size());
+  REQUIRE(grammar.RuleNumber() == report.rule_firsts.size());
+  REQUIRE(report.rule_firsts[4].Test(grammar.SymbolIndex(kRightParen)));
+
+  // a call conflicts with a name on the same terminal
+  GrammarBuilder builder(std::move(grammar));
+  builder.InsertRule(kFactor, {kName, kLeftParen, kExpr, kRightParen},
+                     [](void *) {});
+  grammar = builder.Build();
+
+  REQUIRE(!BuildLLTable(grammar, ll_table, &report));
+  REQUIRE(1 == report.conflicts.size());
+  auto &conflict = report.conflicts.front();
+  REQUIRE(kFactor == grammar.nonterminals()[conflict.nonterminal]);
+  REQUIRE(kName == grammar.terminals()[conflict.terminal]);
+  REQUIRE(11 == conflict.curr_rule);
+  REQUIRE(12 == conflict.new_rule);
+
+  std::ostringstream oss;
+  PrintLLTableReport(oss, grammar, report);
+  REQUIRE(string::npos != oss.str().find("LL(1) conflict on left"));
+  REQUIRE(string::npos != oss.str().find("1 conflicts"));
+}
+
 TEST_CASE("test expr tokenizer", "[Expr Tokenizer]") {
   using namespace expr_grammar;
 
@@ -152,3 +245,58 @@ TEST_CASE("test ll parser", "[LL Parser]") {
   bool result = ll_parser.Parse(expr_data.get(), tokens);
   REQUIRE(result);
 }
+
+static string ExprString(const AstNode *node) {
+  if (node->children().empty()) {
+    return node->str().str();
+  }
+  string s = "(" + node->str().str();
+  for (auto child : node->children()) {
+    s += " " + ExprString(child);
+  }
+  return s + ")";
+}
+
+TEST_CASE("test ll parser with operator table", "[LL Operator]") {
+  using namespace expr_grammar;
+
+  Grammar grammar = BuildExprGrammar();
+  LLTable ll_table;
+  REQUIRE(BuildLLTable(grammar, ll_table));
+
+  Tokenizer tokenizer = BuildExprTokenizer();
+  auto parse = [&](LLParser &parser, const string &s) {
+    vector<Token> tokens;
+    REQUIRE(tokenizer.LexicalAnalyze(s, tokens));
+    auto expr_data = CreateGrammarData();
+    if (!parser.Parse(expr_data.get(), tokens)) {
+      return string("error");
+    }
+    REQUIRE(1 == expr_data->node_record().size());
+    return ExprString(expr_data->node_record().back());
+  };
+
+  LLParser ll_parser(grammar, ll_table);
+  REQUIRE(!ll_parser.SetOperatorTable(kAdd, kFactor, ExprBinaryOperators(),
+                                      CreateExprOperatorHooks()));
+  REQUIRE(ll_parser.SetOperatorTable(kExpr, kFactor, ExprBinaryOperators(),
+                                     CreateExprOperatorHooks()));
+
+  REQUIRE("a" == parse(ll_parser, "a"));
+  REQUIRE("(- (+ a (* 999 (- c 1))) b)"
+              == parse(ll_parser, "a + 999 * (c - 1) - b"));
+  REQUIRE("(- (- 8 3) 2)" == parse(ll_parser, "8 - 3 - 2"));
+  REQUIRE("(+ (/ (* 2 3) 4) 5)" == parse(ll_parser, "2 * 3 / 4 + 5"));
+  REQUIRE("error" == parse(ll_parser, "a + * 1"));
+  REQUIRE("error" == parse(ll_parser, "(a + 1"));
+  REQUIRE("error" == parse(ll_parser, "a 1"));
+
+  auto operators = ExprBinaryOperators();
+  for (auto &op : operators) {
+    op.is_right_assoc = true;
+  }
+  REQUIRE(ll_parser.SetOperatorTable(kExpr, kFactor, operators,
+                                     CreateExprOperatorHooks()));
+  REQUIRE("(- 8 (- 3 2))" == parse(ll_parser, "8 - 3 - 2"));
+  REQUIRE("(+ (* 2 3) (- 4 5))" == parse(ll_parser, "2 * 3 + 4 - 5"));
+}
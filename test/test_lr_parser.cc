@@ -0,0 +1,219 @@
+//
+// Created by Dyinnz on 16-10-18.
+//
+
+#define CATCH_CONFIG_MAIN
+
+#include <fstream>
+#include <sstream>
+
+#include "catch.hpp"
+#include "simplelogger.h"
+#include "lr_parser.h"
+#include "expr_grammar.h"
+#include "golike_grammar.h"
+
+using namespace simple_logger;
+BaseLogger logger;
+
+using std::string;
+using std::vector;
+
+static const string kTestPath("test/testgo/src/");
+
+static string ReadFile(const string &path) {
+  std::ifstream fin(kTestPath + path);
+  std::ostringstream oss;
+  oss << fin.rdbuf();
+  return oss.str();
+}
+
+/**
+ * @brief   the same rules of grammar, whose callbacks record the tokens and
+ *          rules into a vector<string> as grammar data
+ */
+static Grammar BuildTraceGrammar(const Grammar &grammar) {
+  GrammarBuilder builder;
+  builder.SetSymbolTable(Grammar::SymbolTable(grammar.symbol_table()));
+  builder.SetTokenFeeder([](void *data, const TokenView &token) {
+    static_cast<vector<string> *>(data)->push_back(token.text.str());
+  });
+  for (size_t i = 0; i < grammar.RuleNumber(); ++i) {
+    auto &rule = grammar.GetRule(i);
+    builder.InsertRule(rule.left(), Sequence(rule.right()), [i](void *data) {
+      static_cast<vector<string> *>(data)->push_back(std::to_string(i));
+    });
+  }
+  return builder.Build();
+}
+
+static void TestSameTrace(const Grammar &grammar,
+                          const Tokenizer &tokenizer,
+                          const string &source) {
+  Grammar trace_grammar = BuildTraceGrammar(grammar);
+  LLTable ll_table;
+  REQUIRE(BuildLLTable(trace_grammar, ll_table));
+  LRTable lr_table;
+  REQUIRE(BuildLRTable(trace_grammar, lr_table));
+
+  vector<Token> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(source, tokens));
+
+  vector<string> ll_trace;
+  vector<string> lr_trace;
+  LLParser ll_parser(trace_grammar, ll_table);
+  LRParser lr_parser(trace_grammar, lr_table);
+  REQUIRE(ll_parser.Parse(&ll_trace, tokens));
+  REQUIRE(lr_parser.Parse(&lr_trace, tokens));
+  REQUIRE(ll_trace == lr_trace);
+}
+
+TEST_CASE("LR table for expr") {
+  Grammar grammar = expr_grammar::BuildExprGrammar();
+  LRTable lr_table;
+  LRTableReport report;
+  REQUIRE(BuildLRTable(grammar, lr_table, &report));
+  REQUIRE(report.conflicts.empty());
+  REQUIRE(report.state_num == lr_table.state_num());
+  REQUIRE(report.packed_size < report.dense_size);
+
+  std::ostringstream oss;
+  PrintLRTableReport(oss, grammar, report);
+  REQUIRE(string::npos != oss.str().find("0 conflicts"));
+
+  Tokenizer tokenizer = expr_grammar::BuildExprTokenizer();
+  vector<Token> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze("a + 999 * (c - 1) ", tokens));
+
+  LRParser lr_parser(grammar, lr_table);
+  auto expr_data = expr_grammar::CreateGrammarData();
+  REQUIRE(lr_parser.Parse(expr_data.get(), tokens));
+
+  tokens.clear();
+  REQUIRE(tokenizer.LexicalAnalyze("a + * 1", tokens));
+  REQUIRE(!lr_parser.Parse(expr_grammar::CreateGrammarData().get(), tokens));
+}
+
+TEST_CASE("LR parser has the same callbacks of LL parser") {
+  TestSameTrace(expr_grammar::BuildExprGrammar(),
+                expr_grammar::BuildExprTokenizer(),
+                "a + 999 * (c - 1) / b - (1)");
+
+  Grammar grammar = golike_grammar::BuildGolikeGrammar();
+  Tokenizer tokenizer = golike_grammar::BuildGolikeTokenizer();
+  const char *paths[] = {
+      "testcase/basic_type.go", "testcase/comment.go", "testcase/for.go",
+      "testcase/func.go", "testcase/if.go", "testcase/import.go",
+      "testcase/switch.go", "testcase/var.go", "main/hellogo.go",
+  };
+  for (auto path : paths) {
+    INFO(path);
+    TestSameTrace(grammar, tokenizer, ReadFile(path));
+  }
+}
+
+TEST_CASE("LR parser with golike grammar data") {
+  using namespace golike_grammar;
+  Grammar grammar = BuildGolikeGrammar();
+  LRTable lr_table;
+  REQUIRE(BuildLRTable(grammar, lr_table));
+
+  Tokenizer tokenizer = BuildGolikeTokenizer();
+  vector<Token> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(ReadFile("testcase/func.go"), tokens));
+
+  LRParser lr_parser(grammar, lr_table);
+  auto parse_data = CreateGolikeGrammarData();
+  REQUIRE(lr_parser.Parse(parse_data.get(), tokens));
+  REQUIRE(!parse_data->node_stack().empty());
+
+  tokens.clear();
+  REQUIRE(tokenizer.LexicalAnalyze("package main\n\nfunc F() {\n", tokens));
+  REQUIRE(!lr_parser.Parse(CreateGolikeGrammarData().get(), tokens));
+}
+
+/**
+ * @brief   a left recursive grammar, which is not LL(1), evaluates the
+ *          expression with a stack of values
+ */
+TEST_CASE("LR parser for left recursion") {
+  using namespace expr_grammar;
+  typedef vector<long> Values;
+
+  auto binary = [](long (*op)(long, long)) {
+    return [op](void *data) {
+      auto &values = *static_cast<Values *>(data);
+      long rhs = values.back();
+      values.pop_back();
+      values.back() = op(values.back(), rhs);
+    };
+  };
+
+  GrammarBuilder builder;
+  builder.SetSymbolTable({kExpr, kTerm, kFactor, kAdd, kSub, kMul, kDiv,
+                          kLeftParen, kRightParen, kNumber,
+                          kEpsilonSymbol, kEofSymbol, kStartSymbol});
+  builder.SetTokenFeeder([](void *data, const TokenView &token) {
+    if (kNumber == token.symbol) {
+      static_cast<Values *>(data)->push_back(
+          std::stol(token.text.str()));
+    }
+  });
+  auto nothing = [](void *) {};
+  builder.InsertRule(kStartSymbol, {kExpr}, nothing);
+  builder.InsertRule(kExpr, {kExpr, kAdd, kTerm},
+                     binary([](long a, long b) { return a + b; }));
+  builder.InsertRule(kExpr, {kExpr, kSub, kTerm},
+                     binary([](long a, long b) { return a - b; }));
+  builder.InsertRule(kExpr, {kTerm}, nothing);
+  builder.InsertRule(kTerm, {kTerm, kMul, kFactor},
+                     binary([](long a, long b) { return a * b; }));
+  builder.InsertRule(kTerm, {kTerm, kDiv, kFactor},
+                     binary([](long a, long b) { return a / b; }));
+  builder.InsertRule(kTerm, {kFactor}, nothing);
+  builder.InsertRule(kFactor, {kLeftParen, kExpr, kRightParen}, nothing);
+  builder.InsertRule(kFactor, {kNumber}, nothing);
+  Grammar grammar = builder.Build();
+
+  LLTable ll_table;
+  REQUIRE(!BuildLLTable(grammar, ll_table));
+  LRTable lr_table;
+  REQUIRE(BuildLRTable(grammar, lr_table));
+
+  Tokenizer tokenizer = BuildExprTokenizer();
+  LRParser lr_parser(grammar, lr_table);
+  auto evaluate = [&](const string &s) {
+    vector<Token> tokens;
+    REQUIRE(tokenizer.LexicalAnalyze(s, tokens));
+    Values values;
+    REQUIRE(lr_parser.Parse(&values, tokens));
+    REQUIRE(1 == values.size());
+    return values.back();
+  };
+  REQUIRE(3 == evaluate("8 - 3 - 2"));
+  REQUIRE(2 == evaluate("16 / 4 / 2"));
+  REQUIRE(14 == evaluate("2 + 3 * 4"));
+  REQUIRE(20 == evaluate("(2 + 3) * 4"));
+}
+
+TEST_CASE("LR table conflicts") {
+  using namespace expr_grammar;
+  GrammarBuilder builder;
+  builder.SetSymbolTable({kExpr, kAdd, kNumber,
+                          kEpsilonSymbol, kEofSymbol, kStartSymbol});
+  auto nothing = [](void *) {};
+  builder.InsertRule(kStartSymbol, {kExpr}, nothing);
+  builder.InsertRule(kExpr, {kExpr, kAdd, kExpr}, nothing);
+  builder.InsertRule(kExpr, {kNumber}, nothing);
+  Grammar grammar = builder.Build();
+
+  LRTable lr_table;
+  LRTableReport report;
+  REQUIRE(!BuildLRTable(grammar, lr_table, &report));
+  REQUIRE(1 == report.conflicts.size());
+  REQUIRE(kAdd == grammar.terminals()[report.conflicts.front().terminal]);
+
+  std::ostringstream oss;
+  PrintLRTableReport(oss, grammar, report);
+  REQUIRE(string::npos != oss.str().find("LALR(1) conflict"));
+}
@@ -0,0 +1,102 @@
+//
+// Created by Dyinnz on 16-10-17.
+//
+
+#define CATCH_CONFIG_MAIN
+
+#include <fstream>
+#include <sstream>
+
+#include "catch.hpp"
+#include "simplelogger.h"
+#include "golike_grammar.h"
+#include "golike_parser_gen.h"
+
+using namespace simple_logger;
+using namespace golike_grammar;
+BaseLogger logger;
+
+using std::string;
+using std::vector;
+
+static const string kTestPath("test/testgo/src/");
+
+static string ReadFile(const string &path) {
+  std::ifstream fin(kTestPath + path);
+  std::ostringstream oss;
+  oss << fin.rdbuf();
+  return oss.str();
+}
+
+static string NodeString(const AstNode *node) {
+  std::ostringstream oss;
+  oss << node->symbol() << ' ' << node->str() << ' ' << node->row() << ':'
+      << node->column() << ' ' << node->children().size();
+  return oss.str();
+}
+
+/**
+ * @brief   the nodes on stack and their children, the snippets of primary
+ *          expression may link the nodes into cycles, so no deeper
+ */
+static vector<string> FlattenNodes(const vector<AstNode *> &node_stack) {
+  vector<string> nodes;
+  for (auto node : node_stack) {
+    nodes.push_back(NodeString(node));
+    for (auto child : node->children()) {
+      nodes.push_back(NodeString(child));
+    }
+  }
+  return nodes;
+}
+
+/**
+ * @brief   the generated parser has the same result and nodes of LLParser
+ */
+static void TestGeneratedParser(const string &source, bool expected) {
+  static Grammar grammar = BuildGolikeGrammar();
+  static LLTable ll_table;
+  static bool is_built = BuildLLTable(grammar, ll_table);
+  REQUIRE(is_built);
+
+  static auto tokenizer = BuildGolikeTokenizer();
+  vector<Token> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(source, tokens));
+
+  vector<TokenView> token_views;
+  for (auto &token : tokens) {
+    token_views.push_back(token.view());
+  }
+  auto generated_views = token_views;
+
+  LLParser parser(grammar, ll_table);
+  auto parse_data = CreateGolikeGrammarData();
+  REQUIRE(expected == parser.Parse(parse_data.get(), token_views));
+
+  auto generated_data = CreateGolikeGrammarData();
+  REQUIRE(expected == ParseGolikeGen(generated_data.get(), generated_views));
+
+  REQUIRE(FlattenNodes(parse_data->node_stack())
+              == FlattenNodes(generated_data->node_stack()));
+}
+
+TEST_CASE("Generated parser for testcases") {
+  const char *paths[] = {
+      "testcase/basic_type.go", "testcase/comment.go", "testcase/for.go",
+      "testcase/func.go", "testcase/if.go", "testcase/import.go",
+      "testcase/switch.go", "testcase/var.go", "simpleadd/add.go",
+      "simplesub/sub.go", "main/hellogo.go",
+  };
+  for (auto path : paths) {
+    INFO(path);
+    string source = ReadFile(path);
+    REQUIRE(!source.empty());
+    TestGeneratedParser(source, true);
+  }
+}
+
+TEST_CASE("Generated parser for errors") {
+  TestGeneratedParser("package main\n\nfunc F() {\n\treturn 1 +\n}\n", false);
+  TestGeneratedParser("package main\n\nvar x int = \n", false);
+  TestGeneratedParser("package main\n\nfunc F() {\n", false);
+}
@@ -142,3 +142,205 @@ TEST_CASE("meta char", "[MetaChar]") {
     REQUIRE_FALSE(dfa->Match("00__\\"));
   }
 }
+
+TEST_CASE("transition table", "[Table]") {
+  RegexParser re_parser;
+  shared_ptr<DFA> dfa{re_parser.ParseToDFA("ab*c")};
+  auto table = dfa->table();
+
+  REQUIRE(table->size() == dfa->size());
+
+  int state = table->start();
+  for (char c : std::string("abbbc")) {
+    state = table->GetNextState(state, c);
+    REQUIRE(DFATable::kDeadState != state);
+  }
+  REQUIRE(table->IsEnd(state));
+
+  REQUIRE(DFATable::kDeadState == table->GetNextState(table->start(), 'b'));
+  REQUIRE(DFATable::kDeadState == table->GetNextState(table->start(), '\xff'));
+}
+
+TEST_CASE("char classes", "[CharClasses]") {
+  RegexParser re_parser;
+  shared_ptr<DFA> dfa{re_parser.ParseToDFA("[a-c]+x|[b-d]")};
+  auto &char_classes = dfa->char_classes();
+
+  // {a}, {b, c}, {d}, {x} and the rest
+  REQUIRE(5 == char_classes.size());
+  REQUIRE(char_classes.GetClass('b') == char_classes.GetClass('c'));
+  REQUIRE(char_classes.GetClass('a') != char_classes.GetClass('b'));
+  REQUIRE(char_classes.GetClass('z') == char_classes.GetClass('\xff'));
+
+  REQUIRE(dfa->table()->class_num() == char_classes.size());
+  REQUIRE(dfa->Match("abcx"));
+  REQUIRE(dfa->Match("d"));
+  REQUIRE_FALSE(dfa->Match("dx"));
+}
+
+TEST_CASE("number set", "[NumberSet]") {
+  NumberSet lhs(10);
+  NumberSet rhs(200);
+
+  REQUIRE(lhs.empty());
+  REQUIRE(lhs.insert(3));
+  REQUIRE(lhs.insert(130));
+  REQUIRE_FALSE(lhs.insert(3));
+  REQUIRE(2 == lhs.size());
+
+  REQUIRE(rhs.insert(130));
+  REQUIRE(lhs != rhs);
+  REQUIRE(rhs.insert(3));
+  REQUIRE(lhs == rhs);
+  REQUIRE(NumberSet::Hasher()(lhs) == NumberSet::Hasher()(rhs));
+
+  NumberSet merged;
+  merged.insert(lhs);
+  merged.insert(64);
+  REQUIRE(merged.contains(64));
+  REQUIRE_FALSE(merged.contains(65));
+
+  std::vector<int> numbers(merged.begin(), merged.end());
+  REQUIRE((numbers == std::vector<int>{3, 64, 130}));
+}
+
+TEST_CASE("minimize methods", "[Minimize]") {
+  RegexParser re_parser;
+  const char *patterns[] = {"(a|b)*abb", "ab*c+d?e|a*b+|c?d", "[abc]+X[0-9]?"};
+
+  for (auto pattern : patterns) {
+    auto *comp = re_parser.ParseToNFAComponent(pattern);
+    auto normal = ConvertNFAToDFA(re_parser.GetNFAManager().BuildNFA(comp));
+
+    auto iterative = MinimizeDFA(normal, kIterativeRefine);
+    auto hopcroft = MinimizeDFA(normal, kHopcroft);
+    REQUIRE(iterative->size() == hopcroft->size());
+
+    for (auto s : {"abb", "babb", "ab", "abbcde", "bbb", "d", "aaX1", "X"}) {
+      REQUIRE(normal->Match(s) == hopcroft->Match(s));
+      REQUIRE(iterative->Match(s) == hopcroft->Match(s));
+    }
+  }
+
+  RegexParser abb_parser;
+  REQUIRE(4 == abb_parser.ParseToDFA("(a|b)*abb")->size());
+}
+
+TEST_CASE("search", "[Search]") {
+  RegexParser re_parser;
+  shared_ptr<DFA> dfa{re_parser.ParseToDFA("ab+|b+c")};
+
+  REQUIRE(1 == dfa->Search(std::string("xabbbc")));
+  REQUIRE(2 == dfa->Search(std::string("xxbbbc")));
+  REQUIRE(std::string::npos == dfa->Search(std::string("xxbbb")));
+
+  // leftmost first, then longest
+  std::string text = "aab abbb bbc c";
+  const char *match_end = nullptr;
+  const char *match_begin =
+      dfa->Search(text.c_str(), text.c_str() + text.length(), match_end);
+  REQUIRE(text.c_str() + 1 == match_begin);
+  REQUIRE(text.c_str() + 3 == match_end);
+
+  std::vector<std::string> matches;
+  for (auto &m : SearchAll(*dfa, text)) {
+    matches.emplace_back(m.begin, m.end);
+  }
+  REQUIRE((matches == std::vector<std::string>{"ab", "abbb", "bbc"}));
+
+  // NFA gives the same matches
+  auto *comp = re_parser.ParseToNFAComponent("ab+|b+c");
+  NFA *nfa = re_parser.GetNFAManager().BuildNFA(comp);
+  std::vector<std::string> nfa_matches;
+  for (auto &m : SearchAll(*nfa, text)) {
+    nfa_matches.emplace_back(m.begin, m.end);
+  }
+  REQUIRE(matches == nfa_matches);
+}
+
+TEST_CASE("search empty match", "[Search]") {
+  RegexParser re_parser;
+  shared_ptr<DFA> dfa{re_parser.ParseToDFA("a*")};
+
+  std::string text = "baab";
+  std::vector<std::pair<size_t, size_t>> matches;
+  for (auto &m : SearchAll(*dfa, text)) {
+    matches.emplace_back(m.begin - text.c_str(), m.length());
+  }
+  REQUIRE((matches == std::vector<std::pair<size_t, size_t>>{
+      {0, 0}, {1, 2}, {3, 0}, {4, 0}}));
+}
+
+TEST_CASE("NFA simulation", "[NFA]") {
+  RegexParser re_parser;
+  const char *patterns[] = {"ab*c+d?e", "(a|b)*X|H(1|2+)?", "\\d\\s\\w\\W\\\\"};
+  const char *strings[] = {"ace", "abbccde", "ae", "abaX", "H", "H122", "H3",
+                           "0 a-\\", "0 a-", ""};
+
+  for (auto pattern : patterns) {
+    NFA *nfa = re_parser.ParseToNFA(pattern);
+    shared_ptr<DFA> dfa = re_parser.ParseToDFA(pattern);
+    for (auto s : strings) {
+      REQUIRE(dfa->Match(s) == nfa->Match(s));
+    }
+  }
+
+  // exponential for backtracking
+  NFA *nfa = re_parser.ParseToNFA("(a|a)*b");
+  std::string text(100000, 'a');
+  REQUIRE_FALSE(nfa->Match(text));
+  text.push_back('b');
+  REQUIRE(nfa->Match(text));
+}
+
+TEST_CASE("lazy DFA", "[LazyDFA]") {
+  RegexParser re_parser;
+  const char *patterns[] = {"ab*c+d?e", "(a|b)*X|H(1|2+)?", "ab+|b+c"};
+  const char *strings[] = {"ace", "abbccde", "ae", "abaX", "H", "H122", "H3",
+                           "abbb", "xxbbbc", ""};
+
+  for (auto pattern : patterns) {
+    auto lazy = re_parser.ParseToLazyDFA(pattern);
+    shared_ptr<DFA> dfa = re_parser.ParseToDFA(pattern);
+    for (auto s : strings) {
+      REQUIRE(dfa->Match(s) == lazy->Match(s));
+      REQUIRE(dfa->Search(s) == lazy->Search(s));
+    }
+  }
+
+  auto lazy = re_parser.ParseToLazyDFA("ab+|b+c");
+  std::string text = "aab abbb bbc c";
+  std::vector<std::string> matches;
+  for (auto &m : SearchAll(*lazy, text)) {
+    matches.emplace_back(m.begin, m.end);
+  }
+  REQUIRE((matches == std::vector<std::string>{"ab", "abbb", "bbc"}));
+  REQUIRE(0 == lazy->flush_count());
+}
+
+TEST_CASE("lazy DFA cache budget", "[LazyDFA]") {
+  RegexParser re_parser;
+  // the DFA has exponential states
+  const char *pattern = "(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)";
+  auto lazy = re_parser.ParseToLazyDFA(pattern, 4096);
+  NFA *nfa = re_parser.ParseToNFA(pattern);
+
+  std::string text;
+  unsigned seed = 1;
+  for (int i = 0; i < 2000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    text.push_back("ab"[(seed >> 16) & 1]);
+  }
+
+  REQUIRE(nfa->Match(text) == lazy->Match(text));
+  REQUIRE(lazy->cache_bytes() <= 4096);
+  REQUIRE(lazy->flush_count() > 0);
+
+  const char *nfa_end = nullptr;
+  const char *lazy_end = nullptr;
+  const char *text_end = text.c_str() + text.length();
+  REQUIRE(nfa->Search(text.c_str(), text_end, nfa_end)
+              == lazy->Search(text.c_str(), text_end, lazy_end));
+  REQUIRE(nfa_end == lazy_end);
+  REQUIRE(lazy->fallback_count() > 0);
+}
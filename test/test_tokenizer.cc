@@ -112,3 +112,59 @@ TEST_CASE("Skip comments") {
     logger.debug("{}", to_string(token));
   }
 }
+
+DEF_TEST_TERMINAL(kElse, 5, "else");
+DEF_TEST_TERMINAL(kFor, 6, "for");
+
+TEST_CASE("Keyword table") {
+  vector<Keyword> keywords{{"if", kIf}, {"else", kElse}, {"for", kFor}};
+
+  KeywordTable keyword_table;
+  REQUIRE(keyword_table.Build(keywords));
+  REQUIRE(kIf == *keyword_table.Find("if", 2));
+  REQUIRE(kElse == *keyword_table.Find("else", 4));
+  REQUIRE(kFor == *keyword_table.Find("for", 3));
+  REQUIRE(nullptr == keyword_table.Find("fo", 2));
+  REQUIRE(nullptr == keyword_table.Find("form", 4));
+  REQUIRE(nullptr == keyword_table.Find("", 0));
+
+  // rebuild by the seed found
+  KeywordTable rebuilt;
+  REQUIRE(rebuilt.Build(keywords, keyword_table.seed(),
+                        keyword_table.slot_num()));
+  REQUIRE(kFor == *rebuilt.Find("for", 3));
+
+  // duplicated keyword
+  KeywordTable duplicated;
+  REQUIRE_FALSE(duplicated.Build({{"if", kIf}, {"if", kFor}}));
+}
+
+TEST_CASE("Lexical analyse with keywords") {
+  TokenizerBuilder tokenizer_builder;
+  tokenizer_builder
+      .SetKeywords({{"if", kIf}, {"else", kElse}}, kWord)
+      .SetPatterns({{R"(\d+)", kNumber},
+                    {R"(\w+)", kWord},
+                    {"[ \t\v\f\r]", kSpaceSymbol},
+                    {"\n", kLFSymbol}
+                   });
+  REQUIRE_FALSE(tokenizer_builder.IsError());
+  auto tokenizer = tokenizer_builder.Build();
+
+  vector<Token> tokens;
+  REQUIRE(tokenizer.LexicalAnalyze("if ifs else\nelse1 1000", tokens));
+  REQUIRE(6 == tokens.size());
+  REQUIRE(kIf == tokens[0].symbol);
+  REQUIRE(kWord == tokens[1].symbol);
+  REQUIRE(kElse == tokens[2].symbol);
+  REQUIRE(kWord == tokens[4].symbol);
+  REQUIRE(kNumber == tokens[5].symbol);
+
+  // the keyword should be lexed as a identifier
+  TokenizerBuilder error_builder;
+  error_builder
+      .SetPatterns({{R"(\d+)", kNumber},
+                    {"[a-z]+", kWord}})
+      .SetKeywords({{"if", kIf}, {"if2", kElse}}, kWord);
+  REQUIRE(error_builder.IsError());
+}
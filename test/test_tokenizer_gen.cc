@@ -0,0 +1,87 @@
+//
+// Created by coder on 16-10-8.
+//
+
+#define CATCH_CONFIG_MAIN
+
+#include <fstream>
+#include <sstream>
+
+#include "catch.hpp"
+#include "simplelogger.h"
+#include "golike_grammar.h"
+#include "golike_tokenizer_gen.h"
+
+using namespace simple_logger;
+using namespace golike_grammar;
+BaseLogger logger;
+
+using std::string;
+
+static const string kTestPath("test/testgo/src/");
+
+static string ReadFile(const string &path) {
+  std::ifstream fin(kTestPath + path);
+  std::ostringstream oss;
+  oss << fin.rdbuf();
+  return oss.str();
+}
+
+static void TestGeneratedTokenizer(const string &path) {
+  string source = ReadFile(path);
+  REQUIRE(!source.empty());
+
+  static auto tokenizer = BuildGolikeTokenizer();
+  static auto generated = BuildGolikeGenTokenizer();
+
+  std::vector<Token> tokens;
+  std::vector<Token> generated_tokens;
+  REQUIRE(tokenizer.LexicalAnalyze(source, tokens));
+  REQUIRE(generated.LexicalAnalyze(source, generated_tokens));
+  REQUIRE(tokens == generated_tokens);
+}
+
+TEST_CASE("Generated tokenizer for func") {
+  TestGeneratedTokenizer("testcase/func.go");
+}
+
+TEST_CASE("Generated tokenizer for comment") {
+  TestGeneratedTokenizer("testcase/comment.go");
+}
+
+TEST_CASE("Generated tokenizer for main") {
+  TestGeneratedTokenizer("main/hellogo.go");
+}
+
+TEST_CASE("Generated scanner") {
+  auto generated = BuildGolikeGenTokenizer();
+  auto &symbols = generated.GetPrioritySymbols();
+
+  auto scan = [&](const string &s) -> Symbol {
+    int priority = -1;
+    const char *end = ScanGolikeGenToken(s.c_str(), s.c_str() + s.length(),
+                                         &priority);
+    if (end != s.c_str() + s.length()) {
+      return kErrorSymbol;
+    }
+    // the keywords are scanned as identifiers
+    auto keyword = FindGolikeGenKeyword(s.c_str(), s.length());
+    return keyword ? *keyword : symbols[priority];
+  };
+
+  REQUIRE(kBreak == scan("break"));
+  REQUIRE(kIdentifier == scan("breaks"));
+  REQUIRE(kIdentifier == scan("brea"));
+  REQUIRE(kVar == scan("var"));
+  REQUIRE(kLeftAssign == scan("<<="));
+  REQUIRE(kFloatLit == scan("3.14"));
+  REQUIRE(kStringLit == scan("\"hello\""));
+  REQUIRE(kErrorSymbol == scan("\"hello"));
+
+  int priority = -1;
+  string text = "for{";
+  REQUIRE(text.c_str() + 3 == ScanGolikeGenToken(
+      text.c_str(), text.c_str() + text.length(), &priority));
+  REQUIRE(kIdentifier == symbols[priority]);
+  REQUIRE(kFor == *FindGolikeGenKeyword(text.c_str(), 3));
+}